@@ -9,16 +9,23 @@ public:
     BluetoothManager(SystemCoordinator &coord);
     void begin();
     void loop();
+    // Run by the "reboot" command; never returns. Unset, the command is refused.
+    void setShutdownHook(void (*hook)()) { shutdownHook = hook; }
 
 private:
     SystemCoordinator &coordinator;
     SoftwareSerial btSerial;
     static constexpr size_t LINE_BUF = 64;
-    bool readLine(char *outBuf, size_t maxLen, unsigned long timeoutMs = 800);
-    uint16_t parse12hToMinutes(const char *token) const;
-    uint8_t parseDaysListToMask(const char *token) const;
-    void handleCreateTokens(char *tokens[], int count);
-    void handleUpdateTokens(char *tokens[], int count);
-    void handleDeleteTokens(char *tokens[], int count);
+    // A line without its newline (dropped on the air) runs after this.
+    static constexpr uint32_t LINE_TIMEOUT_MS = 2000;
+    // Assembled across loop() calls so a slow sender never stalls the loop
+    // (and with it the reader UART).
+    char line[LINE_BUF];
+    uint8_t lineLen = 0;
+    uint32_t lastByteMs = 0;
+    void (*shutdownHook)() = nullptr;
+    void dispatchLine();
+    // Passage hook: "PASS <tag index> IN|OUT" on the BT link.
+    static void onPassage(void *ctx, uint8_t tagIdx, PassageDirection dir);
     static void trimInPlace(char *s);
 };
\ No newline at end of file
@@ -0,0 +1,109 @@
+#pragma once
+#include <Arduino.h>
+#include <stdint.h>
+#include "../Core/SystemCoordinator.h"
+
+// Addressed multi-drop protocol for several PawPass doors on one RS-485 pair.
+// The primary owns the tag and interval tables and replicates every change to
+// the replicas; replicas only ever talk when polled, so the bus is collision
+// free. Frame: A5 <dst> <src> <seq> <type> <len> <payload> <crc16 lo> <crc16 hi>.
+//
+// Live changes are broadcast with an incrementing sequence number. Each poll
+// returns the replica's last applied sequence; a replica that fell behind is
+// caught up from the primary's short change journal, or, if the journal no
+// longer covers the gap (or the replica just booted), re-sent the full tables.
+// A replica stages the snapshot and keeps its old tables until the whole of it
+// has arrived, so a resync cut short never leaves the door without tags.
+class DoorBus
+{
+public:
+    DoorBus(SystemCoordinator &coord, Stream &busPort, uint8_t busAddress, uint8_t nodes, uint8_t rs485DePin = 0xFF);
+    void begin();
+    void loop();
+    bool isPrimary() const { return address == BUS_PRIMARY_ADDRESS; }
+    bool isSynced() const { return synced; }
+    uint8_t getSeq() const { return seq; }
+    uint16_t getCrcErrors() const { return crcErrors; }
+    uint16_t getTimeouts() const { return timeouts; }
+    uint16_t getFullSyncs() const { return fullSyncs; }
+    uint16_t getCatchUps() const { return catchUps; }
+
+private:
+    static constexpr uint8_t MAX_PAYLOAD = 20;
+
+    struct StagedTag
+    {
+        uint8_t len;
+        uint8_t id[MAX_TAG_ID_LEN];
+    };
+
+    struct JournalEntry
+    {
+        CoordinatorChange kind;
+        uint8_t len;
+        uint8_t key[MAX_TAG_ID_LEN];
+    };
+
+    enum XferMode : uint8_t
+    {
+        XFER_NONE,
+        XFER_CATCHUP,
+        XFER_FULL,
+    };
+
+    SystemCoordinator &coordinator;
+    Stream &port;
+    uint8_t address;
+    uint8_t nodeCount;
+    uint8_t dePin;
+
+    // Receive state.
+    uint8_t rxBuf[MAX_PAYLOAD + 8];
+    uint8_t rxIndex = 0;
+    uint32_t rxLastByteMs = 0;
+
+    // Primary: change journal, live broadcast and polling state.
+    JournalEntry journal[BUS_JOURNAL_SIZE];
+    uint8_t journalCount = 0;
+    uint8_t seq = 0;
+    uint8_t broadcastSeq = 0;
+    uint8_t syncedMask = 0;
+    uint8_t pollAddr = 0;
+    bool awaitingReply = false;
+    uint32_t lastPollMs = 0;
+    XferMode xferMode = XFER_NONE;
+    uint8_t xferNode = 0;
+    uint8_t xferCursor = 0;
+    uint8_t xferEndSeq = 0;
+
+    // Replica: what has been applied so far.
+    bool synced = false;
+    bool syncing = false;
+    uint8_t syncItems = 0;
+    // Replica: full snapshot being received, swapped in by a complete END.
+    StagedTag stagedTags[MAX_TAGS];
+    IntervalRecord stagedIntervals[MAX_INTERVALS];
+    uint8_t stagedTagCount = 0;
+    uint8_t stagedIntervalCount = 0;
+
+    uint16_t crcErrors = 0;
+    uint16_t timeouts = 0;
+    uint16_t fullSyncs = 0;
+    uint16_t catchUps = 0;
+
+    static void onCoordinatorChange(void *ctx, CoordinatorChange kind, const uint8_t *key, uint8_t keyLen);
+    static uint16_t crc16(const uint8_t *data, uint8_t len);
+    void receiveByte(uint8_t b);
+    void handleFrame(uint8_t src, uint8_t frameSeq, uint8_t type, const uint8_t *payload, uint8_t len);
+    void sendFrame(uint8_t dst, uint8_t frameSeq, uint8_t type, const uint8_t *payload, uint8_t len);
+    void sendJournalEntry(uint8_t dst, uint8_t entrySeq);
+    void sendTag(uint8_t dst, uint8_t frameSeq, uint8_t type, const uint8_t *id, uint8_t len);
+    void sendInterval(uint8_t dst, uint8_t frameSeq, uint8_t type, const char *id);
+    bool journalCovers(uint8_t fromSeq) const;
+    void startTransfer(uint8_t node, uint8_t appliedSeq, bool needFull);
+    void stepTransfer();
+    void primaryLoop(uint32_t now);
+    void applyChange(uint8_t type, const uint8_t *payload, uint8_t len);
+    void stageItem(uint8_t type, const uint8_t *payload, uint8_t len);
+    void commitSnapshot();
+};
\ No newline at end of file
@@ -0,0 +1,92 @@
+#pragma once
+#include <Arduino.h>
+#include <stdint.h>
+#include "Core/SystemCoordinator.h"
+
+// Argument types, one nibble each in CommandDef::schema (first argument in
+// the low nibble). ARG_SELECT marks the keyword that is part of the command
+// name ("upd <id> st ..." is the command "upd st"); ARG_DAYS takes the rest
+// of the line. OR with ARG_OPTIONAL for trailing optional arguments.
+enum ArgType : uint8_t
+{
+    ARG_NONE,
+    ARG_ID,     // interval id, 1..11 chars
+    ARG_TIME,   // 12 h clock "hhmm" + a/p, e.g. 0730a -> minutes
+    ARG_DAYS,   // "[1, 3, 5]" (7 = Sunday) -> day mask, default all days
+    ARG_BOOL,   // true/1/on, false/0/off
+    ARG_WORD,   // any single token
+    ARG_SELECT,
+    ARG_OPTIONAL = 0x8,
+};
+
+constexpr uint8_t COMMAND_MAX_ARGS = 4;
+
+constexpr uint16_t argSchema(uint8_t a = ARG_NONE, uint8_t b = ARG_NONE, uint8_t c = ARG_NONE, uint8_t d = ARG_NONE)
+{
+    return static_cast<uint16_t>(a | (b << 4) | (c << 8) | (d << 12));
+}
+
+enum CommandStatus : uint8_t
+{
+    CMD_OK,
+    CMD_ERR_UNKNOWN,
+    CMD_ERR_ARGS,
+    CMD_ERR_VALUE,
+    CMD_ERR_REJECTED,
+    CMD_ERR_REPLICA,
+};
+
+// CommandDef::flags
+constexpr uint8_t CMD_EDITS_TABLES = 0x01; // refused on bus replicas
+
+struct CommandArg
+{
+    const char *text; // token as received (ARG_ID, ARG_WORD, ARG_SELECT)
+    uint16_t value;   // minutes, day mask or 0/1
+    bool present;
+};
+
+struct CommandArgs
+{
+    CommandArg v[COMMAND_MAX_ARGS];
+};
+
+// What a handler may touch; out is wherever the command came from.
+// shutdown, if the transport has one, saves state and resets the board.
+struct CommandContext
+{
+    SystemCoordinator &coordinator;
+    Print &out;
+    void (*shutdown)();
+};
+
+typedef CommandStatus (*CommandHandler)(CommandContext &ctx, const CommandArgs &args);
+
+struct CommandDef
+{
+    char name[8];
+    uint16_t schema;
+    uint8_t flags;
+    CommandHandler handler;
+};
+
+// Defined in Commands.cpp, sorted by name (checked at compile time).
+extern const CommandDef COMMANDS[];
+extern const uint8_t COMMAND_COUNT;
+
+// Transport-independent command dispatch over the PROGMEM table: binary
+// search on the name, then the schema drives argument parsing, so handlers
+// only see typed values. Text transports call execute(); binary ones can
+// resolve a name once with find() and invoke() with pre-parsed arguments.
+class CommandRegistry
+{
+public:
+    // Parses and runs one text line (modified in place), then replies
+    // "OK" or "ERR <reason>" on ctx.out.
+    static CommandStatus execute(char *line, CommandContext &ctx);
+    static int8_t find(const char *name);
+    static CommandStatus invoke(uint8_t index, CommandContext &ctx, const CommandArgs &args);
+    static void reply(Print &out, CommandStatus status);
+    // Command list with schemas and the table's flash/RAM cost.
+    static void list(Print &out);
+};
@@ -3,12 +3,74 @@
 
 constexpr uint8_t MAX_INTERVALS = 10;
 constexpr uint8_t MAX_TAGS = 8;
-constexpr unsigned long COORDINATOR_CHECK_INTERVAL_MS = 60000UL;
+// Longest tag ID any reader driver produces (UHF EPC-96).
+constexpr uint8_t MAX_TAG_ID_LEN = 12;
+constexpr uint32_t COORDINATOR_CHECK_INTERVAL_MS = 60000UL;
+#if defined(__AVR_ATmega2560__)
+// SoftwareSerial RX needs a pin-change interrupt pin on the Mega.
+constexpr uint8_t BT_RX_PIN = 10;
+constexpr uint8_t BT_TX_PIN = 11;
+#else
 constexpr uint8_t BT_RX_PIN = 2;
 constexpr uint8_t BT_TX_PIN = 3;
-constexpr unsigned long BT_BAUD = 9600UL;
+#endif
+constexpr uint32_t BT_BAUD = 9600UL;
 constexpr uint8_t SERVO_PIN = 9;
-constexpr unsigned long DOOR_DELAY_MS = 3000UL;
+constexpr uint32_t DOOR_DELAY_MS = 3000UL;          // until a tag has learned its own
+constexpr uint16_t DOOR_DELAY_MIN_MS = 1500;
+constexpr uint16_t DOOR_DELAY_MAX_MS = 8000;
+constexpr uint8_t DOOR_LEARN_PASSAGES = 4;          // passages before the learned delay is used
+constexpr uint16_t DOOR_PULSE_CLOSED_US = 500;
+constexpr uint16_t DOOR_PULSE_OPEN_US = 2500;
+constexpr uint16_t DOOR_TRAVEL_MS = 600;            // full closed<->open ramp
+constexpr uint32_t DOOR_SETTLE_MS = 400UL;          // at rest before detaching
+constexpr uint8_t SIGHTING_CACHE_SIZE = 4;
+constexpr uint32_t SIGHTING_WINDOW_MS = 500UL;
+
+// UHF reader supervision: each multi-poll runs a bounded burst of rounds and
+// the next one is sent as soon as the module has gone quiet.
+constexpr uint16_t UHF_POLL_ROUNDS = 25;
+constexpr uint32_t UHF_ROUND_QUIET_MS = 60UL;             // no frame for this long: burst over
+constexpr uint32_t UHF_RESPONSE_TIMEOUT_MS = 250UL;       // first frame after a command
+constexpr uint32_t UHF_BURST_MAX_MS = 5000UL;             // re-poll even if frames never stop
+constexpr uint8_t UHF_MAX_FAILURES = 3;                   // consecutive, before re-init
+constexpr uint32_t UHF_REINIT_BACKOFF_MS = 5000UL;
+constexpr uint16_t UHF_TX_POWER_CDBM = 2000;              // 20.00 dBm
+
+// Multi-door RS-485 bus: address 0 is the primary, 1..nodeCount-1 replicas.
+constexpr uint8_t BUS_PRIMARY_ADDRESS = 0;
+constexpr uint8_t BUS_BROADCAST = 0xFF;
+constexpr uint8_t BUS_MAX_NODES = 8;
+constexpr uint8_t BUS_JOURNAL_SIZE = 4;
+constexpr uint32_t BUS_BAUD = 38400UL;
+constexpr uint32_t BUS_POLL_PERIOD_MS = 100UL;
+constexpr uint32_t BUS_REPLY_TIMEOUT_MS = 20UL;
+constexpr uint32_t BUS_FRAME_GAP_MS = 5UL;
+constexpr uint8_t BUS_DE_PIN = 4;
+
+// EEPROM: background write queue (power of two) and table store location.
+constexpr uint8_t EEPROM_QUEUE_SIZE = 16;
+constexpr uint16_t EEPROM_TABLES_ADDR = 0;
+
+// Reader driver: UhfM100Driver, Em4100Driver or FdxbDriver
+#ifndef READER_DRIVER
+#define READER_DRIVER UhfM100Driver
+#endif
+
+// Field trace capture: ring bytes of raw reader and BT RX, dumped with the BT
+// "trace" command. 0 = compiled out.
+#ifndef TRACE_CAPTURE
+#define TRACE_CAPTURE 0
+#endif
+
+// Build stamp folded into the warm-restart magic. Defaults to the release
+// version, so identical sources give identical images; bump the version when
+// a change reinterprets the saved state without resizing it, or pass
+// -DBUILD_ID="..." (e.g. the git hash) to stamp each build.
+#define FIRMWARE_VERSION "1.0.0"
+#ifndef BUILD_ID
+#define BUILD_ID FIRMWARE_VERSION
+#endif
 
 // Debug mode: 0 = disabled, 1 = enabled
 #ifndef DEBUG_MODE
@@ -32,7 +94,23 @@ constexpr unsigned long DOOR_DELAY_MS = 3000UL;
 #endif
 
 #include <avr/pgmspace.h>
-static const uint8_t DEFAULT_TAGS[][12] PROGMEM = {
+// Tags enrolled on a cold boot until the owner's own table has been stored,
+// one list per reader ID length (the driver's ID_LEN): two EPC-96 UHF tags.
+// The LF readers ship with none; enroll microchipped pets with "tag add".
+static const uint8_t DEFAULT_TAGS_EPC96[][12] PROGMEM = {
     {0xE2, 0x00, 0x47, 0x09, 0x3E, 0xB0, 0x64, 0x26, 0xB8, 0x4A, 0x01, 0x13},
     {0xE2, 0x00, 0x47, 0x10, 0x80, 0x30, 0x60, 0x26, 0x99, 0x06, 0x01, 0x0B}};
-static constexpr uint8_t DEFAULT_TAGS_COUNT = sizeof(DEFAULT_TAGS) / sizeof(DEFAULT_TAGS[0]);
\ No newline at end of file
+
+template <uint8_t IdLen>
+struct DefaultTags
+{
+    static constexpr uint8_t COUNT = 0;
+    static const uint8_t *at(uint8_t) { return nullptr; }
+};
+
+template <>
+struct DefaultTags<12>
+{
+    static constexpr uint8_t COUNT = sizeof(DEFAULT_TAGS_EPC96) / sizeof(DEFAULT_TAGS_EPC96[0]);
+    static const uint8_t *at(uint8_t i) { return DEFAULT_TAGS_EPC96[i]; }
+};
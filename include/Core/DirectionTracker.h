@@ -0,0 +1,48 @@
+#pragma once
+#include <stdint.h>
+#include "Config.h"
+#include "ReaderSide.h"
+
+enum PetLocation : uint8_t
+{
+    LOCATION_UNKNOWN,
+    LOCATION_INSIDE,
+    LOCATION_OUTSIDE,
+};
+
+enum PassageDirection : uint8_t
+{
+    PASSAGE_NONE,
+    PASSAGE_IN,
+    PASSAGE_OUT,
+};
+
+// Infers in/out passages per tag from the antenna that saw it first and the
+// one that saw it last within one passage (the coordinator's presence span).
+// Reads that alternate while the pet stands in the flap do not matter, and a
+// pet that turns back ends on the side it started from: no passage.
+// O(1) per sighting. Trivially constructible: lives in the .noinit coordinator.
+class DirectionTracker
+{
+public:
+    void reset();
+    void clear(uint8_t idx);
+    // Drops entry idx and shifts the following ones down, like the tag table.
+    void remove(uint8_t idx, uint8_t count);
+    void onSighting(uint8_t idx, ReaderSide side, bool passageStart);
+    PassageDirection endPassage(uint8_t idx);
+    PetLocation getLocation(uint8_t idx) const { return idx < MAX_TAGS ? tracks[idx].location : LOCATION_UNKNOWN; }
+    uint16_t getInCount() const { return ins; }
+    uint16_t getOutCount() const { return outs; }
+
+private:
+    struct Track
+    {
+        ReaderSide first;
+        ReaderSide last;
+        PetLocation location;
+    };
+    Track tracks[MAX_TAGS];
+    uint16_t ins;
+    uint16_t outs;
+};
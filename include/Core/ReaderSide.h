@@ -0,0 +1,11 @@
+#pragma once
+#include <stdint.h>
+
+// Which antenna a sighting came from. READER_SINGLE is the one-reader build,
+// which carries no direction information.
+enum ReaderSide : uint8_t
+{
+    READER_SINGLE,
+    READER_INSIDE,
+    READER_OUTSIDE,
+};
@@ -2,6 +2,8 @@
 #include <Arduino.h>
 #include <stdint.h>
 #include "../Core/Config.h"
+#include "../Door/DoorActuator.h"
+#include "DirectionTracker.h"
 
 struct IntervalRecord
 {
@@ -12,10 +14,56 @@ struct IntervalRecord
     bool enabled;
 };
 
+// Per-tag passage statistics behind the adaptive close delay. Gaps are the
+// time between raw reads within one passage (mean and mean deviation, like a
+// TCP RTO estimator); transit is first-to-last read of a whole passage.
+// passages saturates at UINT16_MAX.
+struct TagTransit
+{
+    uint32_t firstSeen;
+    uint16_t reads;
+    uint16_t gapMean;
+    uint16_t gapDev;
+    uint16_t transitMean;
+    uint16_t readsMean;
+    uint16_t passages;
+};
+
+// One aggregated sighting from a reader front end: the reads folded into it,
+// their peak RSSI, how long ago the newest of them was taken (trailing edges
+// are emitted when their window closes, after the read itself) and the
+// longest gap between consecutive raw reads leading up to it (0 = not
+// measured: the time since the previous sighting is used instead).
+struct TagSighting
+{
+    uint8_t reads;
+    int8_t rssi;
+    uint16_t ageMs;
+    uint16_t gapMs;
+    ReaderSide side;
+};
+
+enum CoordinatorChange : uint8_t
+{
+    CHANGE_TAG_ADDED,
+    CHANGE_TAG_REMOVED,
+    CHANGE_INTERVAL_SET,
+    CHANGE_INTERVAL_DELETED,
+};
+
+// Called after every tag or interval table edit with the key of the changed
+// entry (tag ID bytes or interval id string), e.g. to replicate it.
+typedef void (*CoordinatorChangeHook)(void *ctx, CoordinatorChange kind, const uint8_t *key, uint8_t keyLen);
+
+// Called when a two-reader door sees a tag cross from one antenna to the other.
+typedef void (*PassageHook)(void *ctx, uint8_t tagIdx, PassageDirection dir);
+
+// Trivially constructible on purpose: the firmware instance lives in .noinit
+// so a watchdog or brown-out reset can resume from it (see begin()).
 class SystemCoordinator
 {
 public:
-    void begin();
+    void begin(bool allowWarm = true);
     bool addInterval(const char *id, uint16_t startMin, uint16_t endMin, uint8_t daysMask);
     bool updateIntervalTime(const char *id, uint16_t startMin, uint16_t endMin, uint8_t daysMask);
     bool deleteInterval(const char *id);
@@ -24,27 +72,86 @@ public:
     bool setIntervalStart(const char *id, uint16_t startMin);
     bool setIntervalEnd(const char *id, uint16_t endMin);
     bool setIntervalDays(const char *id, uint8_t daysMask);
+    bool putInterval(const IntervalRecord &rec);
+    void clearIntervals();
+    uint8_t getIntervalCount() const { return intervalCount; }
+    const IntervalRecord *getInterval(uint8_t i) const { return i < intervalCount ? &intervals[i] : nullptr; }
+    const IntervalRecord *findInterval(const char *id) const;
     void onTagDetected(const uint8_t *epc, uint8_t len);
-    bool addTag(const uint8_t *epc, uint8_t len = 12);
+    void onTagSighting(uint8_t idx, const TagSighting &s);
+    bool addTag(const uint8_t *id, uint8_t len);
+    bool removeTag(const uint8_t *id, uint8_t len);
+    void clearTags();
     uint8_t getNumTags() const { return numTags; }
+    const uint8_t *getTag(uint8_t idx, uint8_t &len) const;
+    // Bumped whenever tag indices may change; caches keyed by index check it.
+    uint8_t getTagTableVersion() const { return tagTableVersion; }
+    const TagTransit *getTransit(uint8_t idx) const { return idx < numTags ? &transit[idx] : nullptr; }
+    // Seeds a tag's learned statistics (trace replay); the passage in
+    // progress, if any, is left alone.
+    void setTransit(uint8_t idx, const TagTransit &t);
+    uint16_t getCloseDelayMs(uint8_t idx) const;
+    PetLocation getLocation(uint8_t idx) const { return idx < numTags ? direction.getLocation(idx) : LOCATION_UNKNOWN; }
+    const DirectionTracker &getDirection() const { return direction; }
+    int8_t findTagIndex(const uint8_t *epc, uint8_t len) const;
     bool isValidTag(const uint8_t *epc, uint8_t len) const;
     void loop();
     bool isRfidEnabled() const { return rfidEnabled; }
+    bool isDoorOpen() const { return doorOpen; }
+    DoorMotion getDoorMotion() const { return door.getMotion(); }
+    bool wasWarmStart() const { return warmStart; }
+    // Set on bus replicas, whose tables are owned by the primary: local edit
+    // commands are refused (the bus still applies the primary's changes).
+    void setReplica(bool on) { replica = on; }
+    bool isReplica() const { return replica; }
+    // micros() when begin() had driven the door to its cold or resumed state.
+    uint32_t getReadyUs() const { return readyUs; }
+    // Schedule clock: millis() carried across warm restarts.
+    uint32_t getClockMs() const { return clockMs(); }
+    void setChangeHook(CoordinatorChangeHook hook, void *ctx);
+    void setPassageHook(PassageHook hook, void *ctx);
 
 private:
+    // Must stay the first member: the checksum covers everything after it.
+    uint16_t warmChecksum;
+    uint32_t warmMagic;
     IntervalRecord intervals[MAX_INTERVALS];
-    uint8_t intervalCount = 0;
-    uint8_t tags[MAX_TAGS][12];
-    uint8_t numTags = 0;
-    bool tagPresent[MAX_TAGS] = {0};
-    unsigned long lastSeen[MAX_TAGS] = {0};
-    bool rfidEnabled = false;
-    unsigned long lastCheckMs = 0;
-    bool doorOpen = false;
+    uint8_t intervalCount;
+    uint8_t tags[MAX_TAGS][MAX_TAG_ID_LEN];
+    uint8_t tagLen[MAX_TAGS];
+    uint8_t numTags;
+    bool tagPresent[MAX_TAGS];
+    uint32_t lastSeen[MAX_TAGS];
+    TagTransit transit[MAX_TAGS];
+    DirectionTracker direction;
+    uint8_t tagTableVersion;
+    bool rfidEnabled;
+    uint32_t lastCheckMs;
+    bool doorOpen;
+    DoorActuator door;
+    bool warmStart;
+    bool replica;
+    uint32_t readyUs;
+    uint32_t clockBaseMs;
+    uint32_t savedClockMs;
+    uint32_t dayStartMs; // schedule clock at 00:00 of the current day
+    uint16_t dayNumber;  // days since the cold boot
+    CoordinatorChangeHook changeHook;
+    void *changeCtx;
+    PassageHook passageHook;
+    void *passageCtx;
+    uint32_t clockMs() const { return millis() + clockBaseMs; }
+    bool isWarmStateValid() const;
+    void resumeWarm();
+    void seal();
+    uint16_t computeChecksum() const;
+    void notifyChange(CoordinatorChange kind, const void *key, uint8_t keyLen);
+    void notifyInterval(uint8_t idx);
     int8_t findIndexById(const char *id) const;
-    int8_t findTagIndex(const uint8_t *epc, uint8_t len) const;
     void evaluateNow(bool forced = false);
     void checkTagTimeouts();
+    void recordGap(uint8_t idx, uint32_t gapMs);
+    void endPassage(uint8_t idx);
     void openDoor();
     void closeDoor();
     uint16_t getCurrentMinutes() const;
@@ -0,0 +1,31 @@
+#pragma once
+#include <Arduino.h>
+#include <stdint.h>
+
+// Heartbeat bits, one per cooperative task driven from loop().
+enum WatchdogTask : uint8_t
+{
+    WDT_TASK_BT = 0x01,
+    WDT_TASK_RFID = 0x02,
+    WDT_TASK_COORD = 0x04,
+    WDT_TASK_BUS = 0x08,
+};
+
+// Hardware watchdog supervising several loop tasks. The WDT is only fed once
+// every expected task has checked in, so one hung task is enough to trigger a
+// reset. The WDT runs in interrupt+reset mode: the first expiry records which
+// tasks were missing (kept across the reset in .noinit), the second resets.
+class Watchdog
+{
+public:
+    void begin(uint8_t taskMask);
+    void kick(uint8_t task);
+    // Resets the board through the WDT (15 ms) and never returns. The reset
+    // is a watchdog one, so the coordinator resumes warm.
+    static void reboot() __attribute__((noreturn));
+    // MCUSR at reset, 0 if the bootloader did not pass it on (see Watchdog.cpp).
+    uint8_t resetFlags() const;
+    bool wasWatchdogReset() const;
+    bool wasPowerOnReset() const;
+    uint8_t stalledTasks() const;
+};
\ No newline at end of file
@@ -0,0 +1,28 @@
+#pragma once
+#include <Arduino.h>
+#include <stdint.h>
+
+// One row of the static RAM accounting table, kept in PROGMEM.
+struct MemFootprint
+{
+    char name[8];
+    uint16_t bytes;
+};
+
+// SRAM usage probe. At boot (.init3) everything between the end of
+// .data/.bss/.noinit and the top of RAM is painted with a canary; the deepest
+// the stack has ever reached is wherever the canary was first overwritten.
+// On the host the same API paints a window of the simulator's own stack.
+class MemProfiler
+{
+public:
+    static void begin(const MemFootprint *table, uint8_t count);
+    // Bytes between heap end and stack pointer right now.
+    static uint16_t freeNow();
+    // Deepest stack use since boot: top of RAM down to the lowest byte the
+    // stack has written, in bytes.
+    static uint16_t stackPeak();
+    // Bytes between the current heap end and that lowest byte.
+    static uint16_t neverUsed();
+    static void report(Print &out);
+};
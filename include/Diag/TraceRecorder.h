@@ -0,0 +1,48 @@
+#pragma once
+#include <Arduino.h>
+#include <stdint.h>
+#include "Core/Config.h"
+
+class SystemCoordinator;
+
+enum TraceSource : uint8_t
+{
+    TRACE_RFID,  // reader on Serial (the outside one on two-reader doors)
+    TRACE_BT,
+    TRACE_RFID2, // inside reader
+};
+
+// Ring of timestamped input bytes for reproducing field bugs on the host
+// (sim/TraceReplay.cpp): the raw RX of the readers, taken in
+// RFIDManager::loop() before the driver parses it, and of the BT module.
+// Bytes of one source read in the same millisecond share a chunk: a header
+// with the source in the top two bits and the length - 1 in the low six,
+// the ms since the previous chunk, then up to 64 data bytes. Source 3 is a
+// gap marker, one more byte and no data: 13-bit advance in ms, or in seconds
+// when bit 5 is set, so a quiet night costs a few bytes. When full the oldest
+// chunks are dropped. Compiled to no-ops unless TRACE_CAPTURE > 0.
+class TraceRecorder
+{
+public:
+#if TRACE_CAPTURE > 0
+    static void record(TraceSource src, uint8_t b);
+    static void setCapturing(bool on);
+    static bool isCapturing();
+    static void clear();
+    static uint16_t size();
+    // millis() of the oldest byte still in the ring.
+    static uint32_t oldestMs();
+#else
+    static void record(TraceSource, uint8_t) {}
+    static void setCapturing(bool) {}
+    static bool isCapturing() { return false; }
+    static void clear() {}
+    static uint16_t size() { return 0; }
+    static uint32_t oldestMs() { return 0; }
+#endif
+    // Text dump ("TRACE v3"): header, the coordinator's tags with their
+    // learned passage statistics and the interval table, then the ring
+    // oldest chunk first as hex. These are the tables at dump time, not at
+    // the oldest byte, so a replay across table edits is approximate.
+    static void dump(Print &out, const SystemCoordinator &coord);
+};
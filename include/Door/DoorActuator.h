@@ -0,0 +1,46 @@
+#pragma once
+#include <Arduino.h>
+#include <stdint.h>
+#include "../Core/Config.h"
+
+enum DoorMotion : uint8_t
+{
+    DOOR_CLOSED,
+    DOOR_OPENING,
+    DOOR_OPEN,
+    DOOR_CLOSING,
+};
+
+// Drives the flap servo without blocking: open()/close() only set a target and
+// update() moves the pulse width along an S-curve (smoothstep) so the servo
+// never sees a full-travel step and its inrush current stays low. A new
+// command mid-motion starts a fresh ramp from the current pulse, so a pet
+// re-sighted while the door is closing reverses it in place. Once at rest for
+// DOOR_SETTLE_MS the servo is detached (no pulses, no holding current).
+//
+// Plain data, no initializers: it is part of the .noinit coordinator state.
+class DoorActuator
+{
+public:
+    void begin(uint8_t servoPin, uint32_t now);
+    void resume(uint8_t servoPin, uint32_t now);
+    void open(uint32_t now);
+    void close(uint32_t now);
+    void update(uint32_t now);
+    DoorMotion getMotion() const { return motion; }
+    uint16_t getPulseUs() const { return pulseUs; }
+    bool isAttached() const { return attached; }
+
+private:
+    uint8_t pin;
+    DoorMotion motion;
+    bool attached;
+    uint16_t pulseUs;
+    uint16_t fromUs;
+    uint16_t toUs;
+    uint16_t moveMs;
+    uint32_t moveStartMs;
+    uint32_t restSinceMs;
+    void startMove(uint16_t target, DoorMotion moving, uint32_t now);
+    void writePulse(uint16_t us);
+};
\ No newline at end of file
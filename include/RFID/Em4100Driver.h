@@ -0,0 +1,31 @@
+#pragma once
+#include <Arduino.h>
+#include <stdint.h>
+#include "../Core/Config.h"
+#include "ReaderHealth.h"
+
+// 125 kHz EM4100 ASCII reader (RDM6300 and clones). Pushes
+// STX <10 hex: version + 32-bit ID> <2 hex: XOR checksum> ETX while a tag is
+// in the field; the tag ID is the 5 decoded bytes.
+class Em4100Driver
+{
+public:
+    static constexpr uint32_t BAUD = 9600UL;
+    static constexpr uint8_t ID_LEN = 5;
+
+    void reset();
+    void poll(Stream &, uint32_t) {}
+    void suspend(Stream &, uint32_t) {}
+    bool feed(uint8_t b);
+    const uint8_t *id() const { return idBuf; }
+    uint8_t idLen() const { return ID_LEN; }
+    int8_t rssi() const { return INT8_MIN; }
+    const ReaderHealth &health() const { return stats; }
+
+private:
+    bool inFrame = false;
+    uint8_t nibbles = 0;
+    uint8_t raw[ID_LEN + 1];
+    uint8_t idBuf[ID_LEN];
+    ReaderHealth stats;
+};
\ No newline at end of file
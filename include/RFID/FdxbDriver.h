@@ -0,0 +1,45 @@
+#pragma once
+#include <Arduino.h>
+#include <stdint.h>
+#include "../Core/Config.h"
+#include "ReaderHealth.h"
+
+// 134.2 kHz ISO 11784/85 FDX-B ASCII reader (WL-134 style). Frame:
+// STX <10 hex national ID, LSB first> <4 hex country, LSB first>
+// <data flag> <animal flag> <4 reserved> <6 extended> <XOR> <~XOR> ETX.
+// The tag ID is the 48-bit (country << 38 | national) value, big endian. The
+// 15-digit number on the pet's microchip certificate is the same code in
+// decimal, country (3 digits) then national ID (12 digits), e.g.
+// 982 000123456789; fromCertificate() converts it for enrolment.
+class FdxbDriver
+{
+public:
+    static constexpr uint32_t BAUD = 9600UL;
+    static constexpr uint8_t ID_LEN = 6;
+
+    // "982000123456789" -> tag ID; false unless 15 digits of a valid code.
+    static bool fromCertificate(const char *digits, uint8_t *id);
+
+    void reset();
+    void poll(Stream &, uint32_t) {}
+    void suspend(Stream &, uint32_t) {}
+    bool feed(uint8_t b);
+    const uint8_t *id() const { return idBuf; }
+    uint8_t idLen() const { return ID_LEN; }
+    int8_t rssi() const { return INT8_MIN; }
+    const ReaderHealth &health() const { return stats; }
+
+private:
+    static constexpr uint8_t PAYLOAD_LEN = 26;
+    static constexpr uint64_t NATIONAL_MAX = 0x3FFFFFFFFFULL; // 38 bits
+    static constexpr uint16_t COUNTRY_MAX = 0x3FF;            // 10 bits
+    static void pack(uint16_t country, uint64_t national, uint8_t *id);
+    bool inFrame = false;
+    uint8_t count = 0;
+    uint8_t sum = 0;
+    uint8_t check = 0;
+    uint64_t national = 0;
+    uint16_t country = 0;
+    uint8_t idBuf[ID_LEN];
+    ReaderHealth stats;
+};
\ No newline at end of file
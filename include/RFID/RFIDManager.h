@@ -1,21 +1,43 @@
 #pragma once
 #include <Arduino.h>
 #include "../Core/SystemCoordinator.h"
+#include "SightingCache.h"
+#include "UhfM100Driver.h"
+#include "Em4100Driver.h"
+#include "FdxbDriver.h"
 
-class RFIDManager
+// Reader front end, parameterised on the wire-format driver so the byte path
+// is resolved at compile time. A driver provides BAUD, ID_LEN, reset(),
+// poll(Stream&, now) (called every loop; commands, if any, are its business),
+// suspend(Stream&, now) (called instead while reading is disabled; a reader
+// that pushes on its own ignores it), feed(uint8_t) -> bool, id()/idLen()/rssi() and health().
+template <class Driver>
+class RFIDManagerT
 {
 public:
-    RFIDManager(SystemCoordinator &coord);
+    static constexpr uint32_t BAUD = Driver::BAUD;
+    static constexpr uint8_t ID_LEN = Driver::ID_LEN;
+
+    // Adds the DefaultTags for this reader's ID format that are not enrolled
+    // yet; for a cold boot, before the stored table is loaded.
+    static void enrollDefaults(SystemCoordinator &coord);
+
+    // side tags sightings for direction inference on two-reader doors.
+    RFIDManagerT(SystemCoordinator &coord, Stream &readerPort = Serial, ReaderSide readerSide = READER_SINGLE);
     void begin();
     void loop();
 
 private:
     SystemCoordinator &coordinator;
-    uint8_t state = 0;
-    uint8_t codeState = 0;
-    uint8_t dataAdd = 0;
-    uint8_t epcBuf[12];
-    uint8_t epcIndex = 0;
+    Stream &port;
+    ReaderSide side;
+    Driver driver;
+    SightingCache sightings;
+    bool suspended = false; // reading disabled, driver told to stop
     void resetStates();
-    void handleEpcComplete();
-};
\ No newline at end of file
+    void handleIdComplete();
+    void emit(SightingEntry &e, uint32_t now);
+};
+
+// Selected with -DREADER_DRIVER=... (see platformio.ini).
+using RFIDManager = RFIDManagerT<READER_DRIVER>;
\ No newline at end of file
@@ -0,0 +1,38 @@
+#pragma once
+#include <Arduino.h>
+#include <stdint.h>
+#include "../Core/ReaderSide.h"
+
+// Link counters kept by every reader driver. Only supervised readers (ones
+// that answer commands) can tell a dead module from an empty field; for
+// push-only readers responsive just means a frame has been seen.
+struct ReaderHealth
+{
+    bool supervised = false;
+    bool responsive = false;
+    uint32_t upSinceMs = 0; // when the reader last became responsive
+    uint32_t frames = 0;         // valid frames, tag or not
+    uint16_t badFrames = 0;      // framing or checksum errors
+    uint16_t timeouts = 0;
+    uint16_t errorFrames = 0;    // error replies other than "no tag"
+    uint16_t reinits = 0;
+
+    void seen(uint32_t now)
+    {
+        if (!responsive)
+        {
+            responsive = true;
+            upSinceMs = now;
+        }
+    }
+};
+
+// Lets the "rdr" command reach the readers' counters without knowing the
+// driver types. RFIDManager::begin() attaches each reader.
+class ReaderMonitor
+{
+public:
+    static constexpr uint8_t MAX_READERS = 2;
+    static void attach(const ReaderHealth *health, ReaderSide side);
+    static void report(Print &out, uint32_t now);
+};
@@ -0,0 +1,48 @@
+#pragma once
+#include <Arduino.h>
+#include <stdint.h>
+#include "../Core/Config.h"
+
+struct SightingEntry
+{
+    uint8_t epc[MAX_TAG_ID_LEN];
+    uint8_t len;
+    uint16_t hash;
+    uint32_t lastReadMs;  // last read of this ID (also drives the LRU)
+    uint32_t windowStart; // when the current aggregation window opened
+    uint16_t maxGapMs;    // longest gap between raw reads since the last emit
+    uint8_t reads;        // reads folded into the current window, not yet emitted
+    int8_t peakRssi;
+    int8_t tagIdx;        // coordinator tag index, -1 = known-unknown ID
+    bool used;
+};
+
+// Small LRU cache of recently sighted tag IDs. Repeated reads of the same ID
+// within SIGHTING_WINDOW_MS fold into a single event carrying the read count
+// and peak RSSI. The first read after a quiet window is emitted at once
+// (leading edge); reads folded in after that are emitted when their window
+// closes (trailing edge, see due()), so the last read of a passage is never
+// lost. Each entry also tracks the longest gap between consecutive raw reads
+// since its last emit (lastReadMs carries across windows). Unknown IDs are
+// cached too (tagIdx < 0) so they are dropped without touching the
+// coordinator. The whole cache is invalidated when the coordinator's tag
+// table version changes.
+class SightingCache
+{
+public:
+    void clear();
+    static uint16_t hashOf(const uint8_t *id, uint8_t len);
+    SightingEntry *find(const uint8_t *id, uint8_t len, uint16_t hash, uint8_t tableVersion);
+    SightingEntry &insert(const uint8_t *id, uint8_t len, uint16_t hash, int8_t tagIdx, uint32_t now);
+    // Folds one read into the entry; true when an event should be emitted.
+    bool addRead(SightingEntry &e, int8_t rssi, uint32_t now);
+    void openWindow(SightingEntry &e, uint32_t now);
+    // A known tag whose window has closed with reads still folded in, if any.
+    SightingEntry *due(uint32_t now);
+    uint16_t getSuppressedReads() const { return suppressedReads; }
+
+private:
+    SightingEntry entries[SIGHTING_CACHE_SIZE];
+    uint8_t version = 0;
+    uint16_t suppressedReads = 0;
+};
\ No newline at end of file
@@ -0,0 +1,28 @@
+#pragma once
+#include <Arduino.h>
+#include <stdint.h>
+
+// Tag IDs as text: what the LF readers send, what "tag add" takes and what
+// "tag ls" and the trace dump print. Two hex digits per byte, high nibble
+// first.
+
+// Value of one hex digit of either case, or -1.
+inline int8_t hexNibble(uint8_t c)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    c |= 0x20;
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    return -1;
+}
+
+inline void printHexBytes(Print &out, const uint8_t *id, uint8_t len)
+{
+    static const char digits[] = "0123456789ABCDEF";
+    for (uint8_t i = 0; i < len; ++i)
+    {
+        out.write(static_cast<uint8_t>(digits[id[i] >> 4]));
+        out.write(static_cast<uint8_t>(digits[id[i] & 0x0F]));
+    }
+}
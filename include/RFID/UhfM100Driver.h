@@ -0,0 +1,91 @@
+#pragma once
+#include <Arduino.h>
+#include <stdint.h>
+#include "../Core/Config.h"
+#include "ReaderHealth.h"
+
+// UHF (M100-class) module. Frames are BB <type> <cmd> <PL:2> <payload> <sum>
+// 7E, sum = low byte of type..payload. Tags arrive as notices
+// (type 02, cmd 22: RSSI, PC:2, EPC, CRC:2); errors as type 01, cmd FF with a
+// code, 0x15 meaning an inventory round found no tag.
+//
+// The driver also supervises the module: every multi-poll is outstanding
+// until its burst of rounds is done (UHF_POLL_ROUNDS "no tag" replies, or
+// UHF_ROUND_QUIET_MS of silence once tags are answering or frames were lost),
+// at which point the next one is sent straight away. No frame within
+// UHF_RESPONSE_TIMEOUT_MS, or an error reply, is a failure; UHF_MAX_FAILURES
+// in a row re-initialise the module (stop inventory, set TX power), retried
+// every UHF_REINIT_BACKOFF_MS until it answers.
+class UhfM100Driver
+{
+public:
+    static constexpr uint32_t BAUD = 115200UL;
+    // EPC-96, the usual tag; idLen() reports what each notice carried.
+    static constexpr uint8_t ID_LEN = 12;
+
+    void reset();
+    // Called every loop while reading is enabled; sends commands as needed.
+    void poll(Stream &port, uint32_t now);
+    // Called every loop while reading is disabled: stops inventory, and stops
+    // it again while frames keep coming. reset() resumes polling.
+    void suspend(Stream &port, uint32_t now);
+    // Consumes one received byte; true once a complete tag ID is available.
+    bool feed(uint8_t b);
+    const uint8_t *id() const { return epcBuf; }
+    uint8_t idLen() const { return epcLen; }
+    int8_t rssi() const { return lastRssi; }
+    const ReaderHealth &health() const { return stats; }
+
+private:
+    enum RxState : uint8_t
+    {
+        RX_HEADER,
+        RX_TYPE,
+        RX_CMD,
+        RX_LEN_HI,
+        RX_LEN_LO,
+        RX_PAYLOAD,
+        RX_SUM,
+        RX_END,
+    };
+    enum Link : uint8_t
+    {
+        LINK_IDLE,
+        LINK_POLLING,
+        LINK_STOPPING,
+        LINK_POWERING,
+        LINK_BACKOFF,
+        LINK_SUSPENDED,
+    };
+    static constexpr uint8_t MAX_PAYLOAD = 5 + MAX_TAG_ID_LEN;
+    static constexpr uint16_t MAX_FRAME_PAYLOAD = 64;
+
+    RxState rxState = RX_HEADER;
+    uint8_t rxType = 0;
+    uint8_t rxCmd = 0;
+    uint8_t rxSum = 0;
+    uint16_t rxLen = 0;
+    uint16_t rxPos = 0;
+    uint8_t payload[MAX_PAYLOAD];
+
+    uint8_t epcBuf[MAX_TAG_ID_LEN];
+    uint8_t epcLen = 0;
+    int8_t lastRssi = 0;
+
+    Link link = LINK_IDLE;
+    bool frameSeen = false;  // any valid frame since the last poll()
+    bool errorSeen = false;  // error reply other than "no tag"
+    uint8_t ackCmd = 0;      // command of the last type-01 reply
+    bool answered = false;   // outstanding command got at least one frame
+    uint16_t burstFrames = 0; // "no tag" rounds since the last multi-poll
+    uint8_t failures = 0;
+    uint32_t sentMs = 0;
+    uint32_t lastFrameMs = 0;
+    ReaderHealth stats;
+
+    bool frameComplete();
+    void send(Stream &port, uint8_t cmd, const uint8_t *data, uint8_t len, uint32_t now);
+    void sendPoll(Stream &port, uint32_t now);
+    void beginReinit(Stream &port, uint32_t now);
+    void fail(Stream &port, uint32_t now);
+};
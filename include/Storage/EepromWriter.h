@@ -0,0 +1,29 @@
+#pragma once
+#include <Arduino.h>
+#include <stdint.h>
+
+// Background EEPROM writes. write() only queues the byte; the EE_READY
+// interrupt programs one byte per ~3.3 ms erase/write cycle, so callers never
+// wait on the EEPROM. Bytes already holding the value are skipped (at queue
+// time when the EEPROM is idle, and again just before programming), and a
+// second write to a still-queued address replaces the queued value.
+// read() sees queued data before it reaches the EEPROM.
+class EepromWriter
+{
+public:
+    // False when the queue is full; the byte was not accepted.
+    bool write(uint16_t addr, uint8_t value);
+    // Queues up to len bytes in order and returns how many were accepted.
+    uint8_t writeBlock(uint16_t addr, const void *src, uint8_t len);
+    // May wait for the byte being programmed if addr is not queued or in flight.
+    uint8_t read(uint16_t addr) const;
+    void readBlock(uint16_t addr, void *dst, uint8_t len) const;
+    // True while anything is queued or being programmed.
+    bool busy() const;
+    uint8_t freeSlots() const;
+    // Barrier: returns once every queued byte is in the EEPROM. Needs
+    // interrupts enabled.
+    void flush();
+    uint16_t getWritten() const;
+    uint16_t getSkipped() const;
+};
@@ -0,0 +1,39 @@
+#pragma once
+#include <Arduino.h>
+#include <stdint.h>
+#include "Core/SystemCoordinator.h"
+#include "EepromWriter.h"
+
+// Keeps the coordinator's interval and tag tables in EEPROM so schedules and
+// enrolled pets survive a power cycle. loop() compares one slot per call
+// against the tables and queues only differing bytes, and only while the
+// writer is idle, so it never waits on the EEPROM. Layout at
+// EEPROM_TABLES_ADDR: magic(2) count(1), then MAX_INTERVALS slots of
+// IntervalRecord + check byte; after that magic(2) count(1) and MAX_TAGS slots
+// of length(1) + ID(MAX_TAG_ID_LEN) + check byte.
+class TableStore
+{
+public:
+    TableStore(SystemCoordinator &coord, EepromWriter &eeprom);
+    // Cold boot only, before anything else edits the tables. A stored tag
+    // table replaces the tags enrolled so far (the defaults). Returns the
+    // number of intervals and tags restored.
+    uint8_t load();
+    void loop();
+    // Runs a whole sweep now and waits until the EEPROM holds it, e.g. before
+    // a deliberate reset. Needs interrupts enabled; takes up to ~3.4 ms per
+    // byte that differs. A brown-out gives no such warning: it loses the
+    // queued bytes, and a slot torn mid-write is dropped on load.
+    void sync();
+
+private:
+    SystemCoordinator &coordinator;
+    EepromWriter &writer;
+    uint8_t cursor = 0; // step of the sweep to run next, see loop()
+    bool stepInterval(uint8_t slot);
+    bool stepTag(uint8_t slot);
+    bool stepHeader(uint16_t addr, uint16_t magic, uint8_t count);
+    bool step();
+    uint8_t loadIntervals();
+    uint8_t loadTags();
+};
@@ -0,0 +1,295 @@
+// Host-side RS-485 bus simulator: one primary and several replica doors, each
+// a full SystemCoordinator + DoorBus, sharing a lossy half-duplex line on a
+// virtual clock. Random provisioning edits arrive as BT command lines at the
+// primary (interval and "tag add/del" commands) while replicas reboot and
+// frames are corrupted; the same commands sent to a replica must be refused.
+// At the end every replica must hold exactly the primary's tag and interval
+// tables, and a replica that is resyncing must go on serving its old tags
+// until the new snapshot is complete (no door left without tags).
+//
+//   bus_sim [nodes=5] [seconds=600] [seed=1] [noise_ppm=2000]
+#include <Arduino.h>
+#include <stdio.h>
+#include <random>
+#include <string>
+#include <map>
+#include <set>
+#include <vector>
+#include "Core/SystemCoordinator.h"
+#include "Bus/DoorBus.h"
+#include "Control/CommandRegistry.h"
+
+namespace
+{
+    struct Node
+    {
+        SystemCoordinator coordinator;
+        HostSerialPort port;
+        DoorBus *bus = nullptr;
+    };
+
+    std::mt19937 rng;
+    uint32_t noisePpm = 0;
+    std::vector<Node *> nodes;
+    uint64_t bytesOnWire = 0;
+
+    bool chance(uint32_t ppm) { return (rng() % 1000000u) < ppm; }
+
+    void deliver(size_t from, uint8_t b)
+    {
+        ++bytesOnWire;
+        for (size_t i = 0; i < nodes.size(); ++i)
+        {
+            if (i == from)
+                continue;
+            // Every receiver sees its own noise, like drops on a long stub.
+            if (chance(noisePpm))
+            {
+                if (rng() & 1)
+                    continue;
+                nodes[i]->port.inject(static_cast<uint8_t>(b ^ (1u << (rng() % 8))));
+                continue;
+            }
+            nodes[i]->port.inject(b);
+        }
+    }
+
+    std::string tagKey(const uint8_t *id, uint8_t len)
+    {
+        return std::string(reinterpret_cast<const char *>(id), len);
+    }
+
+    struct Snapshot
+    {
+        std::set<std::string> tags;
+        std::map<std::string, std::string> intervals;
+        bool operator==(const Snapshot &o) const { return tags == o.tags && intervals == o.intervals; }
+    };
+
+    Snapshot snapshot(const SystemCoordinator &c)
+    {
+        Snapshot s;
+        for (uint8_t i = 0; i < c.getNumTags(); ++i)
+        {
+            uint8_t len;
+            const uint8_t *id = c.getTag(i, len);
+            s.tags.insert(tagKey(id, len));
+        }
+        for (uint8_t i = 0; i < c.getIntervalCount(); ++i)
+        {
+            const IntervalRecord *r = c.getInterval(i);
+            char v[48];
+            snprintf(v, sizeof(v), "%u-%u/%02x/%d", r->startMin, r->endMin, r->daysMask, r->enabled ? 1 : 0);
+            s.intervals[r->id] = v;
+        }
+        return s;
+    }
+
+    struct Reply : Print
+    {
+        std::string text;
+        size_t write(uint8_t b) override
+        {
+            text += static_cast<char>(b);
+            return 1;
+        }
+    };
+
+    // Runs one command line as the BT manager would; returns the reply.
+    std::string command(SystemCoordinator &c, const std::string &line)
+    {
+        Reply reply;
+        CommandContext ctx{c, reply, nullptr};
+        std::vector<char> buf(line.begin(), line.end());
+        buf.push_back('\0');
+        CommandRegistry::execute(buf.data(), ctx);
+        return reply.text;
+    }
+
+    std::string timeArg(unsigned minutes)
+    {
+        unsigned hh = minutes / 60 % 24;
+        char buf[8];
+        snprintf(buf, sizeof(buf), "%02u%02u%c", hh % 12 == 0 ? 12 : hh % 12, minutes % 60, hh < 12 ? 'a' : 'p');
+        return buf;
+    }
+
+    std::string daysArg(unsigned mask)
+    {
+        std::string s = "[";
+        for (unsigned d = 1; d <= 7; ++d)
+        {
+            if (mask & (d == 7 ? 1u : 1u << d))
+                s += (s.size() > 1 ? ", " : "") + std::to_string(d);
+        }
+        return s + "]";
+    }
+
+    std::string randomEdit()
+    {
+        std::string id = "iv" + std::to_string(rng() % 12);
+        std::string tag = (rng() & 1) ? "E2000000000000000000000" : "000000000";
+        tag += std::to_string(rng() % 10);
+        unsigned days = 1 + rng() % 0x7F;
+        switch (rng() % 8)
+        {
+        case 0:
+        case 1:
+            return "s " + id + " " + timeArg(rng() % 1440) + " " + timeArg(rng() % 1440) + " " + daysArg(days);
+        case 2:
+            return "d " + id;
+        case 3:
+            return "upd " + id + " t1 " + timeArg(rng() % 1440);
+        case 4:
+            return "upd " + id + " st " + ((rng() & 1) ? "on" : "off");
+        case 5:
+            return "upd " + id + " dt " + daysArg(days);
+        case 6:
+            return "tag add " + tag;
+        default:
+            return "tag del " + tag;
+        }
+    }
+
+    void bootNode(size_t i)
+    {
+        Node &n = *nodes[i];
+        n.port.clearRx();
+        n.coordinator.begin(false);
+        n.bus->begin();
+    }
+}
+
+int main(int argc, char **argv)
+{
+    unsigned nodeCount = argc > 1 ? atoi(argv[1]) : 5;
+    unsigned seconds = argc > 2 ? atoi(argv[2]) : 600;
+    unsigned seed = argc > 3 ? atoi(argv[3]) : 1;
+    noisePpm = argc > 4 ? atoi(argv[4]) : 2000;
+    if (nodeCount < 2 || nodeCount > BUS_MAX_NODES)
+    {
+        fprintf(stderr, "nodes must be 2..%u\n", BUS_MAX_NODES);
+        return 2;
+    }
+    rng.seed(seed);
+
+    for (unsigned i = 0; i < nodeCount; ++i)
+    {
+        Node *n = new Node();
+        memset(static_cast<void *>(&n->coordinator), 0, sizeof(n->coordinator));
+        n->bus = new DoorBus(n->coordinator, n->port, static_cast<uint8_t>(i), static_cast<uint8_t>(nodeCount));
+        n->port.txHook = [i](uint8_t b) { deliver(i, b); };
+        nodes.push_back(n);
+    }
+    for (unsigned i = 0; i < nodeCount; ++i)
+        bootNode(i);
+
+    const uint64_t endMs = static_cast<uint64_t>(seconds) * 1000;
+    const uint64_t quietMs = endMs > 20000 ? endMs - 20000 : endMs / 2;
+    unsigned edits = 0;
+    unsigned accepted = 0;
+    unsigned refused = 0;
+    unsigned replicaEdits = 0;
+    unsigned reboots = 0;
+    uint64_t blindMs = 0;
+    // Replica has served a non-empty tag table since it booted.
+    std::vector<bool> served(nodeCount, false);
+    uint64_t firstConsistentMs = 0;
+    bool consistent = false;
+
+    for (uint64_t t = 0; t < endMs; t += 10)
+    {
+        if (t < quietMs)
+        {
+            if (chance(20000))
+            {
+                // Bursts of edits, as when a phone app pushes a schedule.
+                unsigned burst = 1 + rng() % 6;
+                for (unsigned k = 0; k < burst; ++k)
+                {
+                    std::string line = randomEdit();
+                    accepted += command(nodes[0]->coordinator, line).compare(0, 2, "OK") == 0;
+                    // Someone pointing the app at a replica door instead.
+                    if (chance(100000))
+                    {
+                        std::string reply = command(nodes[1 + rng() % (nodeCount - 1)]->coordinator, line);
+                        if (reply.compare(0, 11, "ERR replica") == 0)
+                            ++refused;
+                        else
+                            ++replicaEdits;
+                    }
+                }
+                edits += burst;
+            }
+            if (chance(300))
+            {
+                size_t i = 1 + rng() % (nodeCount - 1);
+                bootNode(i);
+                served[i] = false;
+                ++reboots;
+            }
+        }
+        for (Node *n : nodes)
+        {
+            n->bus->loop();
+            n->coordinator.loop();
+        }
+        HostClock::advanceMs(10);
+
+        bool primaryHasTags = nodes[0]->coordinator.getNumTags() > 0;
+        for (unsigned i = 1; i < nodeCount; ++i)
+        {
+            const Node &n = *nodes[i];
+            if (n.bus->isSynced())
+                served[i] = n.coordinator.getNumTags() > 0;
+            else if (served[i] && primaryHasTags && n.coordinator.getNumTags() == 0)
+                blindMs += 10;
+        }
+
+        if (t >= quietMs)
+        {
+            Snapshot ref = snapshot(nodes[0]->coordinator);
+            bool all = true;
+            for (unsigned i = 1; i < nodeCount && all; ++i)
+                all = snapshot(nodes[i]->coordinator) == ref && nodes[i]->bus->isSynced();
+            if (all && !consistent)
+                firstConsistentMs = t - quietMs;
+            consistent = all;
+        }
+    }
+
+    const DoorBus &primary = *nodes[0]->bus;
+    printf("nodes=%u sim_s=%u seed=%u noise_ppm=%u\n", nodeCount, seconds, seed, noisePpm);
+    printf("edits=%u accepted=%u replica_reboots=%u bytes=%llu\n", edits, accepted, reboots,
+           static_cast<unsigned long long>(bytesOnWire));
+    printf("edits sent to replicas: refused=%u applied=%u\n", refused, replicaEdits);
+    printf("replica time without tags while resyncing: %llu ms\n", static_cast<unsigned long long>(blindMs));
+    printf("primary: seq=%u full_syncs=%u catchups=%u poll_timeouts=%u crc_err=%u\n",
+           primary.getSeq(), primary.getFullSyncs(), primary.getCatchUps(), primary.getTimeouts(),
+           primary.getCrcErrors());
+    for (unsigned i = 1; i < nodeCount; ++i)
+    {
+        const Node &n = *nodes[i];
+        printf("node %u: synced=%d seq=%u tags=%u intervals=%u crc_err=%u\n", i, n.bus->isSynced() ? 1 : 0,
+               n.bus->getSeq(), n.coordinator.getNumTags(), n.coordinator.getIntervalCount(),
+               n.bus->getCrcErrors());
+    }
+    if (!consistent)
+    {
+        printf("FAIL: replicas diverged from primary\n");
+        return 1;
+    }
+    if (blindMs)
+    {
+        printf("FAIL: a resyncing replica dropped its tags before the snapshot was complete\n");
+        return 1;
+    }
+    if (replicaEdits)
+    {
+        printf("FAIL: a replica accepted a local table edit\n");
+        return 1;
+    }
+    printf("PASS: all replicas consistent %llu ms after the last edit\n",
+           static_cast<unsigned long long>(firstConsistentMs));
+    return 0;
+}
\ No newline at end of file
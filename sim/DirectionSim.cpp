@@ -0,0 +1,386 @@
+// Two-reader direction simulator. Runs two real RFIDManager front ends (the
+// LF reader the build selects with READER_DRIVER, EM4100 or FDX-B; one
+// antenna outside the flap and one inside) into the real SystemCoordinator on
+// a virtual clock. Pets are enrolled the way an owner does it, with "tag add"
+// over the command registry (hex ID, or the certificate number for FDX-B).
+// Checks that the door opens for every passage the readers heard, and the
+// in/out passage events and tracked pet locations against the modelled
+// ground truth:
+//   - each pet approaches the flap from the side it is on, is read only by
+//     that side's antenna, then sits in the flap where both antennas read it
+//     in no particular order, and either goes through or turns back;
+//   - antennas miss frames, occasionally miss a whole approach, and the wire
+//     drops and corrupts bytes;
+//   - several pets move independently, so passages overlap.
+//
+//   direction_sim [passages=4000] [pets=4] [seed=1] [noise_ppm=1000]
+#include <Arduino.h>
+#include <Servo.h>
+#include <stdio.h>
+#include <algorithm>
+#include <deque>
+#include <random>
+#include <vector>
+#include <string>
+#include <type_traits>
+#include "Core/SystemCoordinator.h"
+#include "Control/CommandRegistry.h"
+#include "RFID/RFIDManager.h"
+#include "ReaderFrames.h"
+
+namespace
+{
+    using Reader = RFIDManager;
+    using Driver = READER_DRIVER;
+    static_assert(!std::is_same<Driver, UhfM100Driver>::value,
+                  "direction_sim models push-mode LF readers: build with -DREADER_DRIVER=Em4100Driver or FdxbDriver");
+
+    constexpr bool FDXB = std::is_same<Driver, FdxbDriver>::value;
+    constexpr uint64_t BYTE_US = 1042; // 10 bits at 9600
+    // Repeat rate with a tag present: RDM6300 65 ms, WL-134 about 100 ms.
+    constexpr uint64_t FRAME_PERIOD_MS = FDXB ? 100 : 65;
+    constexpr double READ_PROBABILITY = 0.7;   // per frame slot, tag in one field
+    constexpr double FLAP_READ_PROBABILITY = 0.4;
+    constexpr double CROSS_PROBABILITY = 0.8;
+    constexpr double BLIND_APPROACH = 0.03;    // antenna misses the whole approach
+
+    enum Phase : uint8_t
+    {
+        AWAY,
+        APPROACH,
+        IN_FLAP,
+        DEPART,
+    };
+
+    struct Passage
+    {
+        uint64_t startMs;
+        PassageDirection truth;
+        PetLocation after;
+        bool heard;  // a frame for this pet went out during the passage
+        bool opened; // the door was open at some point during it
+    };
+
+    struct Pet
+    {
+        uint8_t id[Reader::ID_LEN];
+        std::string enrolAs; // what the owner types after "tag add"
+        PetLocation location;
+        Phase phase;
+        uint64_t phaseEndMs;
+        bool crosses;
+        bool blind;
+        std::vector<Passage> passages;
+        std::vector<std::pair<uint64_t, PassageDirection>> events;
+    };
+
+    struct Antenna
+    {
+        HostSerialPort port;
+        std::deque<std::pair<uint64_t, uint8_t>> queue;
+        ReaderSide side;
+        uint64_t nextFrameMs;
+    };
+
+    std::mt19937_64 rng;
+    uint32_t noisePpm = 1000;
+    std::vector<Pet> pets;
+    SystemCoordinator coordinator;
+    Antenna outside;
+    Antenna inside;
+    Reader readerOut(coordinator, outside.port, READER_OUTSIDE);
+    Reader readerIn(coordinator, inside.port, READER_INSIDE);
+    uint64_t framesSent = 0;
+    uint64_t doorOpens = 0;
+
+    struct Reply : Print
+    {
+        std::string text;
+        size_t write(uint8_t b) override
+        {
+            text += static_cast<char>(b);
+            return 1;
+        }
+    };
+
+    // One command line as the BT manager would run it; true on "OK".
+    bool command(const std::string &line)
+    {
+        Reply reply;
+        CommandContext ctx{coordinator, reply, nullptr};
+        std::vector<char> buf(line.begin(), line.end());
+        buf.push_back('\0');
+        CommandRegistry::execute(buf.data(), ctx);
+        return reply.text.compare(0, 2, "OK") == 0;
+    }
+
+    void makeId(Pet &p)
+    {
+        char text[32];
+        if (FDXB)
+        {
+            // Certificate number: 3-digit country, 12-digit national ID.
+            unsigned country = 900 + rng() % 100;
+            unsigned long long national = rng() % 0x4000000000ULL; // 38 bits
+            snprintf(text, sizeof(text), "%03u%012llu", country, national);
+            FdxbDriver::fromCertificate(text, p.id);
+        }
+        else
+        {
+            for (uint8_t k = 0; k < Reader::ID_LEN; ++k)
+            {
+                p.id[k] = static_cast<uint8_t>(rng());
+                snprintf(text + 2 * k, 3, "%02X", p.id[k]);
+            }
+        }
+        p.enrolAs = text;
+    }
+
+    double uniform() { return std::uniform_real_distribution<double>(0.0, 1.0)(rng); }
+    uint64_t between(uint64_t lo, uint64_t hi) { return lo + rng() % (hi - lo + 1); }
+
+    ReaderSide sideOf(PetLocation loc) { return loc == LOCATION_INSIDE ? READER_INSIDE : READER_OUTSIDE; }
+    PetLocation opposite(PetLocation loc) { return loc == LOCATION_INSIDE ? LOCATION_OUTSIDE : LOCATION_INSIDE; }
+
+    // Read probability of pet p on the antenna facing side, 0 if out of its field.
+    double visibility(const Pet &p, ReaderSide side)
+    {
+        ReaderSide from = sideOf(p.location);
+        switch (p.phase)
+        {
+        case APPROACH:
+            return (side == from && !p.blind) ? READ_PROBABILITY : 0.0;
+        case IN_FLAP:
+            return FLAP_READ_PROBABILITY;
+        case DEPART:
+            if (p.crosses)
+                return side != from ? READ_PROBABILITY : 0.0;
+            return side == from ? READ_PROBABILITY : 0.0;
+        default:
+            return 0.0;
+        }
+    }
+
+    void queueFrame(Antenna &a, Pet &p, uint64_t atUs)
+    {
+        uint8_t f[ReaderFrames::FRAME_MAX];
+        uint8_t n = ReaderFrames::tagFrame<Driver>(p.id, Reader::ID_LEN, f);
+        p.passages.back().heard = true;
+        uint64_t at = a.queue.empty() ? atUs : std::max(atUs, a.queue.back().first + BYTE_US);
+        for (uint8_t i = 0; i < n; ++i, at += BYTE_US)
+        {
+            uint8_t b = f[i];
+            if ((rng() % 1000000u) < noisePpm)
+            {
+                if (rng() & 1)
+                    continue;
+                b ^= static_cast<uint8_t>(1u << (rng() % 8));
+            }
+            a.queue.push_back({at, b});
+        }
+        ++framesSent;
+    }
+
+    void runAntenna(Antenna &a, uint64_t nowMs)
+    {
+        if (nowMs < a.nextFrameMs)
+            return;
+        a.nextFrameMs = nowMs + FRAME_PERIOD_MS;
+        // One tag per slot: the reader locks onto whichever answers first.
+        std::vector<Pet *> heard;
+        for (Pet &p : pets)
+        {
+            if (uniform() < visibility(p, a.side))
+                heard.push_back(&p);
+        }
+        if (!heard.empty())
+            queueFrame(a, *heard[rng() % heard.size()], nowMs * 1000);
+    }
+
+    void deliver(uint64_t nowMs)
+    {
+        for (Antenna *a : {&outside, &inside})
+        {
+            runAntenna(*a, nowMs);
+            while (!a->queue.empty() && a->queue.front().first <= nowMs * 1000)
+            {
+                a->port.inject(a->queue.front().second);
+                a->queue.pop_front();
+            }
+        }
+    }
+
+    void onPassage(void *, uint8_t tagIdx, PassageDirection dir)
+    {
+        if (tagIdx >= pets.size())
+            return;
+        Pet &p = pets[tagIdx];
+        p.events.push_back({HostClock::nowMs(), dir});
+    }
+
+    void step(Pet &p, uint64_t nowMs, unsigned &started, unsigned limit)
+    {
+        if (nowMs < p.phaseEndMs)
+            return;
+        switch (p.phase)
+        {
+        case AWAY:
+            if (started >= limit)
+            {
+                p.phaseEndMs = UINT64_MAX;
+                return;
+            }
+            ++started;
+            p.crosses = uniform() < CROSS_PROBABILITY;
+            p.blind = uniform() < BLIND_APPROACH;
+            p.passages.push_back({nowMs, PASSAGE_NONE, p.location, false, false});
+            if (p.crosses)
+            {
+                p.passages.back().truth = p.location == LOCATION_OUTSIDE ? PASSAGE_IN : PASSAGE_OUT;
+                p.passages.back().after = opposite(p.location);
+            }
+            p.phase = APPROACH;
+            p.phaseEndMs = nowMs + between(300, 2000);
+            break;
+        case APPROACH:
+            p.phase = IN_FLAP;
+            p.phaseEndMs = nowMs + between(200, 1500);
+            break;
+        case IN_FLAP:
+            p.phase = DEPART;
+            p.phaseEndMs = nowMs + between(300, 2000);
+            break;
+        case DEPART:
+            if (p.crosses)
+                p.location = opposite(p.location);
+            p.phase = AWAY;
+            // Long enough apart that two passages never merge.
+            p.phaseEndMs = nowMs + between(DOOR_DELAY_MAX_MS + 4000, 60000);
+            break;
+        }
+    }
+}
+
+int main(int argc, char **argv)
+{
+    unsigned limit = argc > 1 ? atoi(argv[1]) : 4000;
+    unsigned petCount = argc > 2 ? atoi(argv[2]) : 4;
+    unsigned seed = argc > 3 ? atoi(argv[3]) : 1;
+    noisePpm = argc > 4 ? atoi(argv[4]) : 1000;
+    if (petCount > MAX_TAGS)
+    {
+        fprintf(stderr, "at most %u pets\n", MAX_TAGS);
+        return 2;
+    }
+    rng.seed(seed);
+    outside.side = READER_OUTSIDE;
+    inside.side = READER_INSIDE;
+    HostClock::setTickHook(deliver);
+
+    coordinator.begin(false);
+    coordinator.setPassageHook(onPassage, nullptr);
+    coordinator.addInterval("all", 0, 24 * 60 - 1, 0x7F);
+    readerOut.begin();
+    readerIn.begin();
+    for (unsigned i = 0; i < petCount; ++i)
+    {
+        Pet p;
+        makeId(p);
+        p.location = (i & 1) ? LOCATION_OUTSIDE : LOCATION_INSIDE;
+        p.phase = AWAY;
+        p.phaseEndMs = between(1000, 30000);
+        if (!command("tag add " + p.enrolAs) || coordinator.findTagIndex(p.id, Reader::ID_LEN) != static_cast<int>(i))
+        {
+            fprintf(stderr, "enrolment of %s failed\n", p.enrolAs.c_str());
+            return 2;
+        }
+        pets.push_back(p);
+    }
+
+    unsigned started = 0;
+    for (;;)
+    {
+        uint64_t now = HostClock::nowMs();
+        bool busy = false;
+        for (Pet &p : pets)
+        {
+            step(p, now, started, limit);
+            busy |= p.phaseEndMs != UINT64_MAX;
+        }
+        if (!busy && !coordinator.isDoorOpen() && coordinator.getDoorMotion() == DOOR_CLOSED)
+            break;
+        bool wasOpen = coordinator.isDoorOpen();
+        readerOut.loop();
+        readerIn.loop();
+        coordinator.loop();
+        if (coordinator.isDoorOpen())
+        {
+            doorOpens += !wasOpen;
+            for (Pet &p : pets)
+            {
+                if (p.phase != AWAY)
+                    p.passages.back().opened = true;
+            }
+        }
+        delay(10);
+    }
+
+    // An event belongs to the passage it follows, up to the next one.
+    uint64_t total = 0, crossings = 0, correct = 0, wrong = 0, missed = 0, spurious = 0, locationOk = 0;
+    uint64_t heard = 0, shutOut = 0;
+    for (size_t i = 0; i < pets.size(); ++i)
+    {
+        const Pet &p = pets[i];
+        size_t e = 0;
+        for (size_t k = 0; k < p.passages.size(); ++k)
+        {
+            const Passage &ps = p.passages[k];
+            uint64_t until = k + 1 < p.passages.size() ? p.passages[k + 1].startMs : UINT64_MAX;
+            PassageDirection got = PASSAGE_NONE;
+            while (e < p.events.size() && p.events[e].first < until)
+            {
+                if (p.events[e].first >= ps.startMs)
+                    got = p.events[e].second;
+                ++e;
+            }
+            ++total;
+            if (ps.heard)
+            {
+                ++heard;
+                shutOut += !ps.opened;
+            }
+            if (ps.truth != PASSAGE_NONE)
+            {
+                ++crossings;
+                if (got == ps.truth)
+                    ++correct;
+                else if (got == PASSAGE_NONE)
+                    ++missed;
+                else
+                    ++wrong;
+            }
+            else if (got != PASSAGE_NONE)
+            {
+                ++spurious;
+            }
+        }
+        if (coordinator.getLocation(static_cast<uint8_t>(i)) == p.location)
+            ++locationOk;
+    }
+    const DirectionTracker &dt = coordinator.getDirection();
+    printf("reader=%s passages=%llu pets=%u seed=%u noise_ppm=%u frames=%llu virtual_h=%.1f\n",
+           FDXB ? "fdxb" : "em4100", (unsigned long long)total, petCount, seed, noisePpm,
+           (unsigned long long)framesSent, HostClock::nowMs() / 3600000.0);
+    printf("door opens=%llu heard_passages=%llu shut_out=%llu\n", (unsigned long long)doorOpens,
+           (unsigned long long)heard, (unsigned long long)shutOut);
+    printf("crossings=%llu correct=%llu (%.2f%%) wrong=%llu missed=%llu turn_back_events=%llu\n",
+           (unsigned long long)crossings, (unsigned long long)correct,
+           crossings ? 100.0 * correct / crossings : 0.0, (unsigned long long)wrong, (unsigned long long)missed,
+           (unsigned long long)spurious);
+    printf("engine ins=%u outs=%u final_location_ok=%llu/%zu\n", dt.getInCount(), dt.getOutCount(),
+           (unsigned long long)locationOk, pets.size());
+    bool pass = crossings && wrong * 100 <= crossings && correct * 100 >= crossings * 95 && doorOpens &&
+                shutOut * 100 <= heard;
+    printf("%s\n", pass ? "PASS" : "FAIL");
+    return pass ? 0 : 1;
+}
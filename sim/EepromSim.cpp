@@ -0,0 +1,210 @@
+// Host-side storage simulator: EepromWriter and TableStore against the
+// HostEeprom model of the ATmega328P EEPROM (EECR handshake, ~3.4 ms per
+// byte, EE_READY interrupt). Checks that queued writes to one address merge,
+// that unchanged bytes are never programmed, that read() sees queued and
+// in-flight bytes, that the 19-byte interval slots (more than the write queue
+// holds) are stored across several loop() calls, that sync() leaves the
+// EEPROM holding the tables, and that a power cut mid-slot drops only that
+// slot on the next load.
+//
+//   eeprom_sim
+#include <Arduino.h>
+#include <stdio.h>
+#include <string.h>
+#include "HostEeprom.h"
+#include "Core/Config.h"
+#include "Core/SystemCoordinator.h"
+#include "Storage/EepromWriter.h"
+#include "Storage/TableStore.h"
+
+namespace
+{
+    // Above the tables, so the writer checks do not disturb them.
+    constexpr uint16_t SCRATCH_ADDR = HostEeprom::SIZE - 16;
+
+    SystemCoordinator coordinator;
+    SystemCoordinator restored;
+    EepromWriter writer;
+    TableStore store(coordinator, writer);
+    TableStore restoredStore(restored, writer);
+    int failures = 0;
+
+    void check(bool ok, const char *what)
+    {
+        printf("%s: %s\n", ok ? "ok  " : "FAIL", what);
+        if (!ok)
+            ++failures;
+    }
+
+    // Long enough for the sweep to visit every slot and drain the queue.
+    void runStore(uint32_t ms)
+    {
+        for (uint32_t t = 0; t < ms; ++t)
+        {
+            store.loop();
+            delay(1);
+        }
+    }
+
+    bool sameTables(const SystemCoordinator &a, const SystemCoordinator &b)
+    {
+        if (a.getIntervalCount() != b.getIntervalCount() || a.getNumTags() != b.getNumTags())
+            return false;
+        for (uint8_t i = 0; i < a.getIntervalCount(); ++i)
+        {
+            if (memcmp(a.getInterval(i), b.getInterval(i), sizeof(IntervalRecord)) != 0)
+                return false;
+        }
+        for (uint8_t i = 0; i < a.getNumTags(); ++i)
+        {
+            uint8_t lenA, lenB;
+            const uint8_t *idA = a.getTag(i, lenA);
+            const uint8_t *idB = b.getTag(i, lenB);
+            if (lenA != lenB || memcmp(idA, idB, lenA) != 0)
+                return false;
+        }
+        return true;
+    }
+
+    // What a cold boot reads back from the EEPROM.
+    uint8_t reload()
+    {
+        restored.begin(false);
+        restored.clearIntervals();
+        restored.clearTags();
+        return restoredStore.load();
+    }
+
+    void fillTables()
+    {
+        coordinator.begin(false);
+        coordinator.clearIntervals();
+        coordinator.clearTags();
+        coordinator.addInterval("morning", 6 * 60, 9 * 60, 0x7F);
+        coordinator.addInterval("evening", 17 * 60, 21 * 60 + 30, 0x1F);
+        coordinator.addInterval("weekend", 10 * 60, 18 * 60, 0x60);
+        for (uint8_t t = 0; t < 4; ++t)
+        {
+            uint8_t id[MAX_TAG_ID_LEN];
+            for (uint8_t i = 0; i < sizeof(id); ++i)
+                id[i] = static_cast<uint8_t>(0xE2 + 17 * t + i);
+            coordinator.addTag(id, sizeof(id) - t);
+        }
+    }
+
+    void checkWriter()
+    {
+        // The first byte starts programming at once; later writes queue.
+        uint32_t programmed = HostEeprom::programCount();
+        writer.write(SCRATCH_ADDR, 0x11);
+        check(HostEeprom::programming(), "write to an idle EEPROM starts programming");
+        uint8_t freeBefore = writer.freeSlots();
+        writer.write(SCRATCH_ADDR + 1, 1);
+        writer.write(SCRATCH_ADDR + 1, 2);
+        writer.write(SCRATCH_ADDR + 1, 3);
+        check(writer.freeSlots() == freeBefore - 1, "writes to a queued address merge into one entry");
+        check(writer.read(SCRATCH_ADDR) == 0x11 && writer.read(SCRATCH_ADDR + 1) == 3 &&
+                  HostEeprom::peek(SCRATCH_ADDR + 1) == 0xFF,
+              "read() sees in-flight and queued bytes");
+        writer.flush();
+        check(!HostEeprom::programming() && HostEeprom::peek(SCRATCH_ADDR + 1) == 3 &&
+                  HostEeprom::programCount() - programmed == 2,
+              "flush() programs the merged byte once");
+
+        programmed = HostEeprom::programCount();
+        uint16_t skipped = writer.getSkipped();
+        writer.write(SCRATCH_ADDR + 1, 3); // idle: compared at queue time
+        writer.write(SCRATCH_ADDR + 2, 0x22);
+        writer.write(SCRATCH_ADDR, 0x11); // behind a busy EEPROM: compared in the ISR
+        writer.flush();
+        check(HostEeprom::programCount() - programmed == 1 && writer.getSkipped() - skipped == 2,
+              "bytes already holding the value are not programmed");
+
+        // Interval slot: record plus check byte.
+        uint8_t slot[sizeof(IntervalRecord) + 1];
+        memset(slot, 0x5A, sizeof(slot));
+        writer.write(SCRATCH_ADDR + 3, 0); // keep the EEPROM busy
+        uint8_t accepted = writer.writeBlock(SCRATCH_ADDR - sizeof(slot), slot, sizeof(slot));
+        printf("      %u of %u slot bytes queued behind a busy EEPROM (queue %u)\n", accepted,
+               static_cast<unsigned>(sizeof(slot)), EEPROM_QUEUE_SIZE);
+        check(accepted < sizeof(slot), "an interval slot does not fit the write queue");
+        writer.flush();
+    }
+
+    void checkStore()
+    {
+        HostEeprom::erase();
+        check(reload() == 0, "erased EEPROM restores nothing");
+        fillTables();
+        uint32_t programmed = HostEeprom::programCount();
+        runStore(5000);
+        printf("      first sweep programmed %u bytes\n", static_cast<unsigned>(HostEeprom::programCount() - programmed));
+        check(!writer.busy() && reload() == coordinator.getIntervalCount() + coordinator.getNumTags() &&
+                  sameTables(coordinator, restored),
+              "loop() stores the tables across partial slot writes");
+
+        programmed = HostEeprom::programCount();
+        runStore(5000);
+        check(HostEeprom::programCount() == programmed, "unchanged tables program nothing");
+
+        coordinator.setIntervalEnd("evening", 22 * 60);
+        uint8_t id[5] = {1, 2, 3, 4, 5};
+        coordinator.addTag(id, sizeof(id));
+        store.sync();
+        check(!HostEeprom::programming() && !writer.busy(), "sync() returns with the EEPROM idle");
+        reload();
+        check(sameTables(coordinator, restored), "sync() stores the edited tables");
+    }
+
+    void checkPowerCut()
+    {
+        // Change both times of the middle interval and cut power while its
+        // slot is half written.
+        uint32_t programmed = HostEeprom::programCount();
+        coordinator.updateIntervalTime("evening", 16 * 60 + 45, 23 * 60 + 15, 0x1F);
+        uint32_t waited = 0;
+        while (!(HostEeprom::programming() && HostEeprom::programCount() - programmed >= 2) && waited < 5000)
+        {
+            store.loop();
+            delay(1);
+            ++waited;
+        }
+        check(waited < 5000, "the edit reaches the EEPROM");
+        HostEeprom::powerCut();
+        writer.flush(); // RAM queue lost with the power
+        HostEeprom::powerOn();
+
+        uint8_t n = reload();
+        bool others = restored.getIntervalCount() == 2 && restored.findInterval("morning") &&
+                      restored.findInterval("weekend") && !restored.findInterval("evening") &&
+                      memcmp(restored.findInterval("morning"), coordinator.findInterval("morning"),
+                             sizeof(IntervalRecord)) == 0;
+        printf("      after the cut: %u restored, %u intervals\n", n, restored.getIntervalCount());
+        check(others, "the torn interval slot is dropped, the others survive");
+        check(restored.getNumTags() == coordinator.getNumTags(), "tag table survives a cut in the interval slots");
+
+        // The tables as rebooted are stored consistently again.
+        coordinator.deleteInterval("evening");
+        runStore(5000);
+        reload();
+        check(sameTables(coordinator, restored), "the next sweep repairs the torn slot");
+    }
+}
+
+int main()
+{
+    HostEeprom::erase();
+    HostClock::setTickHook([](uint64_t) { HostEeprom::service(); });
+
+    checkWriter();
+    checkStore();
+    checkPowerCut();
+
+    if (failures)
+    {
+        printf("FAIL: %d check(s)\n", failures);
+        return 1;
+    }
+    printf("PASS: EEPROM writer and table store\n");
+    return 0;
+}
@@ -0,0 +1,594 @@
+// End-to-end household load simulator. Runs the real RFIDManager (UHF driver),
+// BluetoothManager and SystemCoordinator against modelled peripherals on a
+// virtual clock:
+//   - pets with exponential inter-arrival times that linger in the antenna
+//     field, plus foreign animals with unregistered tags;
+//   - a UHF reader that answers the multi-poll, stop and set-power commands,
+//     runs the requested number of inventory rounds and streams a notice per
+//     tag read (or a "no tag" error frame) at 115200 baud with per-byte
+//     corruption and drops; it occasionally hangs, staying silent until a
+//     stop command gets through;
+//   - schedule edits typed into the BT link at 9600 baud at random times.
+// Idle stretches (door closed, nobody near) are skipped, so thousands of days
+// run in minutes.
+//
+// Reports tag-to-door latency (first reader byte of the frame that carries the
+// pet's EPC -> first servo pulse of the opening ramp), missed detections (an
+// authorised pet left without the door opening) and false opens (opening with
+// no authorised pet in the field). Pets differ in how long they linger and
+// how well their tag reads, which is what the per-tag close delay learns;
+// door open time and closes with an authorised pet still in the field show
+// how well it did. Reader hangs are reported with how long the door was blind
+// and the driver's health counters ("rdr"). Ends with the "mem" report: host
+// stack high-water of the run and the per-module footprint (x86-64 sizes).
+// PASS needs no false opens, at most 0.1% missed visits and at most one
+// reader UART byte lost to overflow per 100k frames (three pets answering the
+// same round can outrun the 64-byte buffer between two 10 ms loops; a stalled
+// loop loses far more); the exit status is 1 otherwise. Runs past 50 days
+// cross the 32-bit millis() wrap.
+//
+//   household_sim [days=1000] [pets=4] [seed=1] [noise_ppm=1000] [foreign=1]
+//                 [hangs_per_day=0.5] [trace=household_trace.txt]
+//
+// Built with -DTRACE_CAPTURE (env household_trace) it also writes the final
+// "trace" dump, headed by the number of door opens a replay of it should see,
+// for trace_replay --expect-opens.
+#include <Arduino.h>
+#include <SoftwareSerial.h>
+#include <Servo.h>
+#include <stdio.h>
+#include <time.h>
+#include <algorithm>
+#include <deque>
+#include <random>
+#include <vector>
+#include "Core/SystemCoordinator.h"
+#include "Bluetooth/BluetoothManager.h"
+#include "RFID/RFIDManager.h"
+#include "Diag/MemProfiler.h"
+#include "Diag/TraceRecorder.h"
+#include "RFID/ReaderHealth.h"
+
+namespace
+{
+    constexpr uint64_t READER_BYTE_US = 87;   // 10 bits at 115200
+    constexpr uint64_t BT_BYTE_US = 1042;     // 10 bits at 9600
+    constexpr uint64_t ROUND_PERIOD_US = 40000;
+    constexpr double STOP_RECOVERS_HANG = 0.5; // a hung module may need a few stops
+    constexpr uint64_t FALSE_OPEN_GRACE_MS = 200;
+
+    const MemFootprint memFootprints[] = {
+        {"coord", sizeof(SystemCoordinator)},
+        {"bt", sizeof(BluetoothManager)},
+        {"bt_rx", _SS_MAX_RX_BUFF},
+        {"rfid", sizeof(RFIDManager)},
+    };
+
+    class FilePrint : public Print
+    {
+    public:
+        explicit FilePrint(FILE *file) : f(file) {}
+        size_t write(uint8_t b) override { return fputc(b, f) == EOF ? 0 : 1; }
+
+    private:
+        FILE *f;
+    };
+
+    struct TimedByte
+    {
+        uint64_t atUs;
+        uint8_t b;
+        int16_t pet; // pet whose frame starts with this byte, else -1
+    };
+
+    struct Pet
+    {
+        uint8_t epc[12];
+        bool registered;
+        double visitsPerDay;
+        uint64_t dwellMs;
+        double readProbability;
+        uint64_t nextArrivalMs;
+        bool inField;
+        uint64_t leaveMs;
+        uint64_t leftAtMs;
+        // Current visit.
+        bool authorised;
+        bool doorOpenedThisVisit;
+        bool latencyPending;
+        uint64_t firstByteUs;
+    };
+
+    std::mt19937_64 rng;
+    uint32_t noisePpm = 1000;
+    std::vector<Pet> pets;
+
+    SystemCoordinator coordinator;
+    BluetoothManager bt(coordinator);
+    RFIDManager rfid(coordinator, Serial);
+    SoftwareSerial *btPort = nullptr;
+
+    std::deque<TimedByte> readerQueue;
+    std::deque<TimedByte> btQueue;
+    uint64_t readerRoundsLeft = 0;
+    bool readerBurstAnswered = false; // a round of the current multi-poll has run
+    uint64_t nextRoundUs = 0;
+    uint8_t readerCmd[16];
+    uint8_t readerCmdLen = 0;
+    double hangsPerDay = 0.5;
+    bool readerHung = false;
+    uint64_t nextHangMs = 0, hangStartMs = 0;
+    uint64_t hangs = 0, recoveries = 0, maxOutageMs = 0, totalOutageMs = 0;
+
+    bool openLatched = false;
+    std::vector<uint32_t> latenciesUs;
+    std::vector<uint64_t> openTimesMs, closeTimesMs;
+    std::vector<std::pair<uint64_t, uint64_t>> authorisedVisitsMs; // arrival, leave
+    uint64_t visits = 0, authorisedVisits = 0, missed = 0, falseOpens = 0, opens = 0;
+    uint64_t framesSent = 0, btCommands = 0;
+    uint64_t closedOnPet = 0, doorOpenMs = 0, openedAtMs = 0;
+    DoorMotion lastMotion = DOOR_CLOSED;
+
+    double uniform() { return std::uniform_real_distribution<double>(0.0, 1.0)(rng); }
+    uint64_t expMs(double perDay) { return static_cast<uint64_t>(std::exponential_distribution<double>(perDay / 86400000.0)(rng)) + 1; }
+    bool chancePpm(uint32_t ppm) { return (rng() % 1000000u) < ppm; }
+
+    void pushByte(std::deque<TimedByte> &q, uint64_t byteUs, uint64_t notBeforeUs, uint8_t b, int16_t pet)
+    {
+        uint64_t at = q.empty() ? notBeforeUs : std::max(notBeforeUs, q.back().atUs + byteUs);
+        if (chancePpm(noisePpm))
+        {
+            if (rng() & 1)
+                return; // dropped
+            b ^= static_cast<uint8_t>(1u << (rng() % 8));
+        }
+        q.push_back({at, b, pet});
+    }
+
+    void queueFrame(uint8_t type, uint8_t cmd, const uint8_t *payload, uint8_t len, int16_t petIdx, uint64_t atUs)
+    {
+        uint8_t f[32];
+        uint8_t n = 0;
+        f[n++] = 0xBB;
+        f[n++] = type;
+        f[n++] = cmd;
+        f[n++] = 0x00;
+        f[n++] = len;
+        memcpy(f + n, payload, len);
+        n += len;
+        uint8_t sum = 0;
+        for (uint8_t i = 1; i < n; ++i)
+            sum += f[i];
+        f[n++] = sum;
+        f[n++] = 0x7E;
+        for (uint8_t i = 0; i < n; ++i)
+            pushByte(readerQueue, READER_BYTE_US, atUs, f[i], i == 0 ? petIdx : -1);
+        ++framesSent;
+    }
+
+    void queueNotice(const Pet &p, int16_t petIdx, uint64_t atUs)
+    {
+        uint8_t pl[17];
+        pl[0] = static_cast<uint8_t>(-40 - static_cast<int>(rng() % 30)); // RSSI
+        pl[1] = 0x30;
+        pl[2] = 0x00;
+        memcpy(pl + 3, p.epc, 12);
+        pl[15] = static_cast<uint8_t>(rng());
+        pl[16] = static_cast<uint8_t>(rng());
+        queueFrame(0x02, 0x22, pl, sizeof(pl), petIdx, atUs);
+    }
+
+    void queueReply(uint8_t cmd, uint8_t code, uint64_t atUs)
+    {
+        queueFrame(0x01, cmd, &code, 1, -1, atUs);
+    }
+
+    void onReaderCommand(uint8_t cmd, const uint8_t *payload, uint8_t len)
+    {
+        uint64_t now = HostClock::nowUs();
+        uint64_t at = now + 1000 + rng() % 2000;
+        if (readerHung)
+        {
+            if (cmd != 0x28 || uniform() >= STOP_RECOVERS_HANG)
+                return;
+            readerHung = false;
+            ++recoveries;
+            uint64_t outage = now / 1000 - hangStartMs;
+            totalOutageMs += outage;
+            maxOutageMs = std::max(maxOutageMs, outage);
+        }
+        switch (cmd)
+        {
+        case 0x27:
+            // Multi-poll: 22 CNT:2, that many inventory rounds.
+            if (len == 3)
+            {
+                readerRoundsLeft = static_cast<uint64_t>(payload[1]) << 8 | payload[2];
+                readerBurstAnswered = false;
+                nextRoundUs = now + 3000 + rng() % 10000;
+            }
+            break;
+        case 0x28:
+            readerRoundsLeft = 0;
+            queueReply(0x28, 0x00, at);
+            break;
+        case 0xB6:
+            queueReply(0xB6, 0x00, at);
+            break;
+        default:
+            break;
+        }
+    }
+
+    void onReaderTx(uint8_t b)
+    {
+        if (readerCmdLen == 0 && b != 0xBB)
+            return;
+        if (readerCmdLen < sizeof(readerCmd))
+            readerCmd[readerCmdLen++] = b;
+        if (readerCmdLen < 5)
+            return;
+        uint8_t len = readerCmd[4];
+        uint8_t total = 7 + len;
+        if (total > sizeof(readerCmd))
+        {
+            readerCmdLen = 0;
+            return;
+        }
+        if (readerCmdLen < total)
+            return;
+        uint8_t sum = 0;
+        for (uint8_t i = 1; i < 5 + len; ++i)
+            sum += readerCmd[i];
+        if (sum == readerCmd[5 + len] && readerCmd[total - 1] == 0x7E)
+            onReaderCommand(readerCmd[2], readerCmd + 5, len);
+        readerCmdLen = 0;
+    }
+
+    void runReaderRounds(uint64_t nowUs)
+    {
+        while (readerRoundsLeft > 0 && nextRoundUs <= nowUs)
+        {
+            bool any = false;
+            for (size_t i = 0; i < pets.size(); ++i)
+            {
+                if (pets[i].inField && uniform() < pets[i].readProbability)
+                {
+                    queueNotice(pets[i], static_cast<int16_t>(i), nextRoundUs);
+                    any = true;
+                }
+            }
+            if (!any)
+                queueReply(0xFF, 0x15, nextRoundUs);
+            // The module's rounds drift against the firmware's 10 ms loop.
+            nextRoundUs += ROUND_PERIOD_US - 3000 + rng() % 6000;
+            --readerRoundsLeft;
+            readerBurstAnswered = true;
+        }
+    }
+
+    void deliver(uint64_t nowMs)
+    {
+        uint64_t nowUs = nowMs * 1000;
+        if (!readerHung && hangsPerDay > 0 && nowMs >= nextHangMs)
+        {
+            readerHung = true;
+            readerRoundsLeft = 0;
+            hangStartMs = nowMs;
+            ++hangs;
+            nextHangMs = nowMs + expMs(hangsPerDay);
+        }
+        runReaderRounds(nowUs);
+        while (!readerQueue.empty() && readerQueue.front().atUs <= nowUs)
+        {
+            const TimedByte &tb = readerQueue.front();
+            if (tb.pet >= 0)
+            {
+                Pet &p = pets[tb.pet];
+                if (p.latencyPending && p.firstByteUs == 0)
+                    p.firstByteUs = tb.atUs;
+            }
+            Serial.inject(tb.b);
+            readerQueue.pop_front();
+        }
+        while (!btQueue.empty() && btQueue.front().atUs <= nowUs)
+        {
+            btPort->inject(btQueue.front().b);
+            btQueue.pop_front();
+        }
+    }
+
+    bool authorisedPetNear(uint64_t nowMs)
+    {
+        for (const Pet &p : pets)
+        {
+            if (!p.registered)
+                continue;
+            if (p.inField || (p.leftAtMs && nowMs - p.leftAtMs <= FALSE_OPEN_GRACE_MS))
+                return true;
+        }
+        return false;
+    }
+
+    void onServo(const Servo &, int, bool)
+    {
+        if (coordinator.getDoorMotion() != DOOR_OPENING || openLatched)
+            return;
+        openLatched = true;
+        ++opens;
+        uint64_t nowUs = HostClock::nowUs();
+        openTimesMs.push_back(nowUs / 1000);
+        if (!authorisedPetNear(nowUs / 1000))
+            ++falseOpens;
+        for (Pet &p : pets)
+        {
+            if (p.latencyPending && p.firstByteUs)
+            {
+                latenciesUs.push_back(static_cast<uint32_t>(nowUs - p.firstByteUs));
+                p.latencyPending = false;
+            }
+        }
+    }
+
+    void sendBt(const char *line)
+    {
+        uint64_t now = HostClock::nowUs();
+        for (const char *c = line; *c; ++c)
+            pushByte(btQueue, BT_BYTE_US, now, static_cast<uint8_t>(*c), -1);
+        pushByte(btQueue, BT_BYTE_US, now, '\n', -1);
+        ++btCommands;
+    }
+
+    void randomBtEdit()
+    {
+        // Secondary intervals come and go; "all" keeps the door in service.
+        static const char *const times[] = {"0600a", "0730a", "1200p", "0500p", "0930p", "1100p"};
+        char line[48];
+        unsigned id = rng() % 4;
+        switch (rng() % 4)
+        {
+        case 0:
+            snprintf(line, sizeof(line), "s iv%u %s %s [1, 3, 5]", id, times[rng() % 6], times[rng() % 6]);
+            break;
+        case 1:
+            snprintf(line, sizeof(line), "upd iv%u t1 %s", id, times[rng() % 6]);
+            break;
+        case 2:
+            snprintf(line, sizeof(line), "upd iv%u st %s", id, (rng() & 1) ? "on" : "off");
+            break;
+        default:
+            snprintf(line, sizeof(line), "d iv%u", id);
+            break;
+        }
+        sendBt(line);
+    }
+
+    void arrive(Pet &p, uint64_t nowMs)
+    {
+        ++visits;
+        p.inField = true;
+        p.leftAtMs = 0;
+        p.leaveMs = nowMs + p.dwellMs / 2 + rng() % p.dwellMs;
+        p.authorised = p.registered && coordinator.isRfidEnabled();
+        p.doorOpenedThisVisit = coordinator.getDoorMotion() == DOOR_OPENING || coordinator.getDoorMotion() == DOOR_OPEN;
+        p.latencyPending = p.authorised && !p.doorOpenedThisVisit;
+        p.firstByteUs = 0;
+        if (p.authorised)
+        {
+            ++authorisedVisits;
+            authorisedVisitsMs.push_back({nowMs, p.leaveMs});
+        }
+    }
+
+    void leave(Pet &p, uint64_t nowMs)
+    {
+        p.inField = false;
+        p.leftAtMs = nowMs;
+        p.latencyPending = false;
+        if (p.authorised && !p.doorOpenedThisVisit)
+            ++missed;
+        p.nextArrivalMs = nowMs + expMs(p.visitsPerDay);
+    }
+
+    uint32_t percentile(std::vector<uint32_t> &v, double q)
+    {
+        if (v.empty())
+            return 0;
+        size_t k = static_cast<size_t>(q * (v.size() - 1) + 0.5);
+        return v[k];
+    }
+}
+
+int main(int argc, char **argv)
+{
+    unsigned days = argc > 1 ? atoi(argv[1]) : 1000;
+    unsigned petCount = argc > 2 ? atoi(argv[2]) : 4;
+    unsigned seed = argc > 3 ? atoi(argv[3]) : 1;
+    noisePpm = argc > 4 ? atoi(argv[4]) : 1000;
+    unsigned foreign = argc > 5 ? atoi(argv[5]) : 1;
+    hangsPerDay = argc > 6 ? atof(argv[6]) : 0.5;
+    const char *tracePath = argc > 7 ? argv[7] : "household_trace.txt";
+    if (petCount > MAX_TAGS)
+    {
+        fprintf(stderr, "at most %u registered pets\n", MAX_TAGS);
+        return 2;
+    }
+    rng.seed(seed);
+    if (hangsPerDay > 0)
+        nextHangMs = expMs(hangsPerDay);
+    clock_t wallStart = clock();
+
+    Serial.txHook = onReaderTx;
+    Servo::hook = onServo;
+    btPort = SoftwareSerial::findByRxPin(BT_RX_PIN);
+    HostClock::setTickHook(deliver);
+    MemProfiler::begin(memFootprints, sizeof(memFootprints) / sizeof(memFootprints[0]));
+
+    coordinator.begin(false);
+    bt.begin();
+    rfid.begin();
+
+    for (unsigned i = 0; i < petCount + foreign; ++i)
+    {
+        Pet p;
+        memset(&p, 0, sizeof(p));
+        for (uint8_t k = 0; k < 12; ++k)
+            p.epc[k] = static_cast<uint8_t>(rng());
+        p.registered = i < petCount;
+        p.visitsPerDay = p.registered ? 12.0 : 3.0;
+        // Per inventory round; a tag behind the collar buckle reads poorly.
+        p.dwellMs = 1000 + rng() % 8000;
+        p.readProbability = 0.4 + 0.5 * uniform();
+        p.nextArrivalMs = expMs(p.visitsPerDay);
+        if (p.registered)
+            coordinator.addTag(p.epc, 12);
+        pets.push_back(p);
+    }
+    sendBt("s all 1200a 1159p");
+
+    const uint64_t endMs = static_cast<uint64_t>(days) * 86400000ULL;
+    uint64_t nextEditMs = expMs(6.0);
+    while (HostClock::nowMs() < endMs)
+    {
+        uint64_t now = HostClock::nowMs();
+        for (Pet &p : pets)
+        {
+            if (!p.inField && now >= p.nextArrivalMs)
+                arrive(p, now);
+            else if (p.inField && now >= p.leaveMs)
+                leave(p, now);
+        }
+        if (now >= nextEditMs)
+        {
+            randomBtEdit();
+            nextEditMs = now + expMs(6.0);
+        }
+
+        bt.loop();
+        rfid.loop();
+        coordinator.loop();
+
+        DoorMotion m = coordinator.getDoorMotion();
+        if (m != lastMotion)
+        {
+            if (m == DOOR_OPENING && lastMotion == DOOR_CLOSED)
+                openedAtMs = now;
+            if (m == DOOR_CLOSING)
+            {
+                doorOpenMs += now - openedAtMs;
+                closeTimesMs.push_back(now);
+                for (const Pet &p : pets)
+                {
+                    if (p.registered && p.inField)
+                    {
+                        ++closedOnPet;
+                        break;
+                    }
+                }
+            }
+            lastMotion = m;
+        }
+        if (m != DOOR_OPENING)
+            openLatched = false;
+        if (m == DOOR_OPENING || m == DOOR_OPEN)
+        {
+            for (Pet &p : pets)
+            {
+                if (p.inField)
+                    p.doorOpenedThisVisit = true;
+            }
+        }
+
+        // Nothing can happen until the next arrival, edit or hang: skip
+        // ahead, ending the reader's burst. Not before the burst has
+        // answered, or the jump would look like a reader timeout.
+        bool anyInField = false;
+        for (const Pet &p : pets)
+            anyInField |= p.inField;
+        if (!anyInField && m == DOOR_CLOSED && !readerHung && (readerRoundsLeft == 0 || readerBurstAnswered) && readerQueue.empty() &&
+            btQueue.empty() && btPort->available() == 0 && Serial.available() == 0)
+        {
+            uint64_t next = nextEditMs;
+            for (const Pet &p : pets)
+                next = std::min(next, p.nextArrivalMs);
+            if (hangsPerDay > 0)
+                next = std::min(next, nextHangMs);
+            if (next > now + 1000)
+            {
+                readerRoundsLeft = 0;
+                HostClock::set((next - 20) * 1000);
+                continue;
+            }
+        }
+        delay(10);
+    }
+
+    std::sort(latenciesUs.begin(), latenciesUs.end());
+    double wall = static_cast<double>(clock() - wallStart) / CLOCKS_PER_SEC;
+    printf("days=%u pets=%u foreign=%u seed=%u noise_ppm=%u wall_s=%.1f\n", days, petCount, foreign, seed,
+           noisePpm, wall);
+    printf("visits=%llu authorised=%llu opens=%llu frames=%llu bt_cmds=%llu\n",
+           (unsigned long long)visits, (unsigned long long)authorisedVisits, (unsigned long long)opens,
+           (unsigned long long)framesSent, (unsigned long long)btCommands);
+    printf("latency_ms p50=%.1f p90=%.1f p99=%.1f max=%.1f (n=%zu)\n", percentile(latenciesUs, 0.5) / 1000.0,
+           percentile(latenciesUs, 0.9) / 1000.0, percentile(latenciesUs, 0.99) / 1000.0,
+           latenciesUs.empty() ? 0.0 : latenciesUs.back() / 1000.0, latenciesUs.size());
+    printf("missed=%llu (%.3f%%) false_opens=%llu reader_rx_overflow=%lu\n", (unsigned long long)missed,
+           authorisedVisits ? 100.0 * missed / authorisedVisits : 0.0, (unsigned long long)falseOpens,
+           Serial.rxOverflows);
+    printf("door_open_s_per_open=%.2f closed_on_pet=%llu\n", opens ? doorOpenMs / 1000.0 / opens : 0.0,
+           (unsigned long long)closedOnPet);
+    for (uint8_t i = 0; i < coordinator.getNumTags(); ++i)
+    {
+        const TagTransit *t = coordinator.getTransit(i);
+        printf("tag%u passages=%u transit_ms=%u reads=%u gap_ms=%u+-%u close_delay_ms=%u\n", i, t->passages,
+               t->transitMean, t->readsMean, t->gapMean, t->gapDev, coordinator.getCloseDelayMs(i));
+    }
+    printf("reader hangs=%llu recovered=%llu outage_ms max=%llu mean=%.0f\n", (unsigned long long)hangs,
+           (unsigned long long)recoveries, (unsigned long long)maxOutageMs,
+           recoveries ? static_cast<double>(totalOutageMs) / recoveries : 0.0);
+    FilePrint out(stdout);
+    ReaderMonitor::report(out, millis());
+    MemProfiler::report(out);
+#if TRACE_CAPTURE > 0
+    uint64_t oldestMs = HostClock::nowMs() - static_cast<uint32_t>(millis() - TraceRecorder::oldestMs());
+    // What a replay of the dump should count: the opens since the oldest
+    // byte, plus one if the door was open then for a pet still in the field
+    // (a replay starts closed and opens on that pet's next reads).
+    unsigned long windowOpens = 0;
+    uint64_t lastOpenBefore = 0;
+    for (uint64_t t : openTimesMs)
+    {
+        if (t >= oldestMs)
+            ++windowOpens;
+        else
+            lastOpenBefore = t;
+    }
+    bool openAtOldest = lastOpenBefore != 0;
+    for (uint64_t t : closeTimesMs)
+        openAtOldest &= !(t >= lastOpenBefore && t < oldestMs);
+    bool petAtOldest = false;
+    for (const std::pair<uint64_t, uint64_t> &v : authorisedVisitsMs)
+        petAtOldest |= v.first < oldestMs && v.second > oldestMs;
+    windowOpens += openAtOldest && petAtOldest;
+    FILE *tf = fopen(tracePath, "w");
+    if (!tf)
+    {
+        perror(tracePath);
+        return 2;
+    }
+    fprintf(tf, "household_sim days=%u pets=%u seed=%u noise_ppm=%u foreign=%u: replay opens %lu\n",
+            days, petCount, seed, noisePpm, foreign, windowOpens);
+    FilePrint traceOut(tf);
+    TraceRecorder::dump(traceOut, coordinator);
+    fclose(tf);
+    printf("trace %s bytes=%u span_s=%.1f opens=%lu\n", tracePath, TraceRecorder::size(),
+           (HostClock::nowMs() - oldestMs) / 1000.0, windowOpens);
+#else
+    (void)tracePath;
+#endif
+    bool pass = authorisedVisits && falseOpens == 0 && missed * 1000 <= authorisedVisits &&
+                Serial.rxOverflows * 100000 <= framesSent;
+    printf("%s\n", pass ? "PASS" : "FAIL");
+    return pass ? 0 : 1;
+}
\ No newline at end of file
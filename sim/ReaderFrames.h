@@ -0,0 +1,104 @@
+// Wire frames of the supported readers for the host simulators: what the
+// module sends when it reads the tag id. tagFrame<Driver>() picks the format
+// of the reader the firmware is built for. Frames fit in FRAME_MAX bytes.
+#pragma once
+#include <stdint.h>
+#include <string.h>
+#include "RFID/RFIDManager.h"
+
+namespace ReaderFrames
+{
+    constexpr uint8_t FRAME_MAX = 32;
+
+    inline char hexDigit(uint8_t v) { return "0123456789ABCDEF"[v & 0x0F]; }
+
+    // RDM6300: STX <10 hex ID> <2 hex XOR> ETX.
+    inline uint8_t em4100(const uint8_t *id, uint8_t *f)
+    {
+        uint8_t n = 0;
+        uint8_t x = 0;
+        f[n++] = 0x02;
+        for (uint8_t i = 0; i < Em4100Driver::ID_LEN; ++i)
+        {
+            f[n++] = hexDigit(id[i] >> 4);
+            f[n++] = hexDigit(id[i]);
+            x ^= id[i];
+        }
+        f[n++] = hexDigit(x >> 4);
+        f[n++] = hexDigit(x);
+        f[n++] = 0x03;
+        return n;
+    }
+
+    // WL-134: STX <10 hex national, LSB first> <4 hex country, LSB first>
+    // <data flag> <animal flag> <4 reserved> <6 extended> <XOR> <~XOR> ETX.
+    inline uint8_t fdxb(const uint8_t *id, uint8_t *f)
+    {
+        uint64_t value = 0;
+        for (uint8_t i = 0; i < FdxbDriver::ID_LEN; ++i)
+            value = value << 8 | id[i];
+        uint64_t national = value & 0x3FFFFFFFFFULL;
+        uint16_t country = static_cast<uint16_t>(value >> 38);
+        uint8_t n = 0;
+        f[n++] = 0x02;
+        for (uint8_t i = 0; i < 10; ++i)
+            f[n++] = hexDigit(static_cast<uint8_t>(national >> (4 * i)));
+        for (uint8_t i = 0; i < 4; ++i)
+            f[n++] = hexDigit(static_cast<uint8_t>(country >> (4 * i)));
+        const char *flags = "01" "0000" "000000";
+        memcpy(f + n, flags, 12);
+        n += 12;
+        uint8_t x = 0;
+        for (uint8_t i = 1; i < n; ++i)
+            x ^= f[i];
+        f[n++] = x;
+        f[n++] = static_cast<uint8_t>(~x);
+        f[n++] = 0x03;
+        return n;
+    }
+
+    // M100 inventory notice: BB 02 22 <PL:2> RSSI PC:2 EPC CRC:2 <sum> 7E.
+    inline uint8_t uhfNotice(const uint8_t *epc, uint8_t len, int8_t rssi, uint8_t *f)
+    {
+        uint8_t n = 0;
+        f[n++] = 0xBB;
+        f[n++] = 0x02;
+        f[n++] = 0x22;
+        f[n++] = 0x00;
+        f[n++] = static_cast<uint8_t>(len + 5);
+        f[n++] = static_cast<uint8_t>(rssi);
+        f[n++] = static_cast<uint8_t>(len << 2); // PC: EPC length in words
+        f[n++] = 0x00;
+        memcpy(f + n, epc, len);
+        n += len;
+        f[n++] = 0x00; // CRC, not checked by the driver
+        f[n++] = 0x00;
+        uint8_t sum = 0;
+        for (uint8_t i = 1; i < n; ++i)
+            sum += f[i];
+        f[n++] = sum;
+        f[n++] = 0x7E;
+        return n;
+    }
+
+    template <class Driver>
+    uint8_t tagFrame(const uint8_t *id, uint8_t len, uint8_t *f);
+
+    template <>
+    inline uint8_t tagFrame<Em4100Driver>(const uint8_t *id, uint8_t, uint8_t *f)
+    {
+        return em4100(id, f);
+    }
+
+    template <>
+    inline uint8_t tagFrame<FdxbDriver>(const uint8_t *id, uint8_t, uint8_t *f)
+    {
+        return fdxb(id, f);
+    }
+
+    template <>
+    inline uint8_t tagFrame<UhfM100Driver>(const uint8_t *id, uint8_t len, uint8_t *f)
+    {
+        return uhfNotice(id, len, -50, f);
+    }
+}
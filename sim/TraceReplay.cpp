@@ -0,0 +1,342 @@
+// Replays a field trace (the BT "trace" dump of a -DTRACE_CAPTURE build)
+// through the real RFIDManager, BluetoothManager and SystemCoordinator on the
+// virtual clock. The coordinator starts from the dumped tags, their learned
+// passage statistics and the interval table, at the schedule time of the
+// oldest captured byte. The raw reader and BT bytes are injected into their
+// ports at the millisecond they were read in the field, so they go through
+// the reader driver and the sighting cache as they did on the unit. Idle
+// stretches are skipped, and two builds fed the same dump print the same
+// event log unless their behaviour differs, which is what makes bisecting
+// practical.
+//
+// The tables are the ones at dump time, so BT edits inside the trace are
+// applied on top of their own result (a note says so).
+//
+//   pio run -e trace_replay && .pio/build/trace_replay/program dump.txt
+//   .pio/build/trace_replay/program sim/traces/household_uhf.txt --expect-opens 2
+//
+// With --expect-opens the exit status is 1 unless the door opened that many
+// times. The dump may be embedded in a longer terminal log; lines outside
+// TRACE ... END are ignored. Build with -DREADER_DRIVER=... to match the unit.
+#include <Arduino.h>
+#include <SoftwareSerial.h>
+#include <Servo.h>
+#include <stdio.h>
+#include <time.h>
+#include <deque>
+#include <string>
+#include <vector>
+#include "Core/SystemCoordinator.h"
+#include "Bluetooth/BluetoothManager.h"
+#include "RFID/RFIDManager.h"
+#include "Diag/TraceRecorder.h"
+
+namespace
+{
+    constexpr uint64_t TAIL_MS = 10000; // let door timeouts play out after the last byte
+
+    struct TimedEvent
+    {
+        uint64_t atMs;
+        TraceSource src;
+        uint8_t b;
+    };
+
+    struct Trace
+    {
+        unsigned long clock = 0;
+        unsigned long millisAtDump = 0;
+        unsigned long lastMs = 0;
+        std::vector<std::vector<uint8_t>> tags;
+        std::vector<TagTransit> stats;
+        std::vector<IntervalRecord> intervals;
+        std::vector<uint8_t> raw;
+    };
+
+    std::deque<TimedEvent> pending;
+    HostSerialPort readerPort2;
+    SoftwareSerial *btPort = nullptr;
+    uint64_t startMs = 0;
+    unsigned long counts[3] = {0, 0, 0};
+
+    int hexValue(char c)
+    {
+        if (c >= '0' && c <= '9')
+            return c - '0';
+        c = static_cast<char>(tolower(static_cast<unsigned char>(c)));
+        return (c >= 'a' && c <= 'f') ? c - 'a' + 10 : -1;
+    }
+
+    bool parseHex(const char *s, std::vector<uint8_t> &out)
+    {
+        while (*s && !isspace(static_cast<unsigned char>(*s)))
+        {
+            int hi = hexValue(s[0]);
+            int lo = s[1] ? hexValue(s[1]) : -1;
+            if (hi < 0 || lo < 0)
+                return false;
+            out.push_back(static_cast<uint8_t>(hi << 4 | lo));
+            s += 2;
+        }
+        return true;
+    }
+
+    bool load(FILE *f, Trace &t)
+    {
+        char line[512];
+        bool inTrace = false;
+        while (fgets(line, sizeof(line), f))
+        {
+            const char *p = line;
+            while (*p && isspace(static_cast<unsigned char>(*p)))
+                ++p;
+            if (!inTrace)
+            {
+                if (sscanf(p, "TRACE v3 n=%*u clock=%lu millis=%lu last=%lu", &t.clock, &t.millisAtDump,
+                           &t.lastMs) == 3)
+                    inTrace = true;
+                continue;
+            }
+            if (strncmp(p, "END", 3) == 0)
+                return true;
+            if (p[0] == 'G' && p[1] == ' ')
+            {
+                std::vector<uint8_t> id;
+                if (!parseHex(p + 2, id) || id.empty() || id.size() > MAX_TAG_ID_LEN)
+                    return false;
+                TagTransit s;
+                memset(&s, 0, sizeof(s));
+                unsigned passages, gapMean, gapDev, transitMean, readsMean;
+                if (sscanf(p + 2 + 2 * id.size(), "%u %u %u %u %u", &passages, &gapMean, &gapDev, &transitMean,
+                           &readsMean) != 5)
+                    return false;
+                s.passages = static_cast<uint16_t>(passages);
+                s.gapMean = static_cast<uint16_t>(gapMean);
+                s.gapDev = static_cast<uint16_t>(gapDev);
+                s.transitMean = static_cast<uint16_t>(transitMean);
+                s.readsMean = static_cast<uint16_t>(readsMean);
+                t.tags.push_back(id);
+                t.stats.push_back(s);
+            }
+            else if (p[0] == 'I' && p[1] == ' ')
+            {
+                IntervalRecord r;
+                memset(&r, 0, sizeof(r));
+                unsigned start, end, days, en;
+                char id[sizeof(r.id)];
+                if (sscanf(p + 2, "%11s %u %u %u %u", id, &start, &end, &days, &en) != 5)
+                    return false;
+                memcpy(r.id, id, sizeof(id));
+                r.startMin = static_cast<uint16_t>(start);
+                r.endMin = static_cast<uint16_t>(end);
+                r.daysMask = static_cast<uint8_t>(days);
+                r.enabled = en != 0;
+                t.intervals.push_back(r);
+            }
+            else if (p[0] == 'T' && p[1] == ' ')
+            {
+                if (!parseHex(p + 2, t.raw))
+                    return false;
+            }
+        }
+        return false;
+    }
+
+    // Decode chunks to byte times relative to the first chunk.
+    bool decode(const Trace &t, std::vector<TimedEvent> &out, uint64_t &spanMs)
+    {
+        uint64_t at = 0;
+        bool first = true;
+        size_t i = 0;
+        while (i < t.raw.size())
+        {
+            uint8_t hdr = t.raw[i];
+            uint8_t src = hdr >> 6;
+            size_t len = src == 3 ? 0 : (hdr & 0x3F) + 1u;
+            if (i + 2 + len > t.raw.size())
+                return false;
+            uint8_t b = t.raw[i + 1];
+            if (src == 3)
+            {
+                // Gap marker: 13 bits of ms, or of seconds with bit 5 set.
+                uint64_t g = static_cast<uint64_t>(hdr & 0x1F) << 8 | b;
+                if (!first)
+                    at += (hdr & 0x20) ? g * 1000 : g;
+            }
+            else
+            {
+                if (!first)
+                    at += b;
+                first = false;
+                for (size_t k = 0; k < len; ++k)
+                    out.push_back({at, static_cast<TraceSource>(src), t.raw[i + 2 + k]});
+            }
+            i += 2 + len;
+        }
+        spanMs = at;
+        return true;
+    }
+
+    void deliver(uint64_t nowMs)
+    {
+        while (!pending.empty() && startMs + pending.front().atMs <= nowMs)
+        {
+            const TimedEvent &ev = pending.front();
+            if (ev.src == TRACE_BT)
+                btPort->inject(ev.b);
+            else
+                (ev.src == TRACE_RFID2 ? readerPort2 : Serial).inject(ev.b);
+            pending.pop_front();
+        }
+    }
+
+    void stamp()
+    {
+        printf("%10.3f ", (HostClock::nowMs() - startMs) / 1000.0);
+    }
+
+    void onChange(void *, CoordinatorChange kind, const uint8_t *key, uint8_t keyLen)
+    {
+        static const char *const names[] = {"tag_added", "tag_removed", "interval_set", "interval_deleted"};
+        stamp();
+        printf("%s ", names[kind]);
+        if (kind == CHANGE_TAG_ADDED || kind == CHANGE_TAG_REMOVED)
+        {
+            for (uint8_t i = 0; i < keyLen; ++i)
+                printf("%02X", key[i]);
+            printf("\n");
+            return;
+        }
+        printf("%.*s\n", keyLen, reinterpret_cast<const char *>(key));
+    }
+
+    void onPassage(void *, uint8_t tagIdx, PassageDirection dir)
+    {
+        stamp();
+        printf("passage idx=%u %s\n", tagIdx, dir == PASSAGE_IN ? "in" : "out");
+    }
+}
+
+int main(int argc, char **argv)
+{
+    long expectOpens = -1;
+    if (argc == 4 && strcmp(argv[2], "--expect-opens") == 0)
+        expectOpens = atol(argv[3]);
+    if (argc != 2 && expectOpens < 0)
+    {
+        fprintf(stderr, "usage: %s <trace dump | -> [--expect-opens N]\n", argv[0]);
+        return 2;
+    }
+    FILE *f = strcmp(argv[1], "-") == 0 ? stdin : fopen(argv[1], "r");
+    if (!f)
+    {
+        perror(argv[1]);
+        return 2;
+    }
+    Trace trace;
+    std::vector<TimedEvent> events;
+    uint64_t spanMs = 0;
+    if (!load(f, trace) || !decode(trace, events, spanMs))
+    {
+        fprintf(stderr, "no valid TRACE v3 ... END block in %s\n", argv[1]);
+        return 2;
+    }
+    bool twoReaders = false;
+    for (const TimedEvent &ev : events)
+    {
+        ++counts[ev.src];
+        twoReaders |= ev.src == TRACE_RFID2;
+    }
+
+    // Schedule time of the first byte: the newest chunk was read at
+    // last (millis), i.e. (millis - last) before the dumped clock.
+    uint64_t newestClock = trace.clock - (trace.millisAtDump - trace.lastMs);
+    startMs = newestClock >= spanMs ? newestClock - spanMs : 0;
+    HostClock::set(startMs * 1000);
+
+    static SystemCoordinator coordinator;
+    static BluetoothManager bt(coordinator);
+    static RFIDManager rfid(coordinator, Serial, twoReaders ? READER_OUTSIDE : READER_SINGLE);
+    static RFIDManager rfid2(coordinator, readerPort2, READER_INSIDE);
+    btPort = SoftwareSerial::findByRxPin(BT_RX_PIN);
+    // Bytes were captured after the UART buffer; never drop them again.
+    Serial.rxCapacity = btPort->rxCapacity = readerPort2.rxCapacity = 1 << 16;
+    Serial.txHook = [](uint8_t) {};
+    btPort->txHook = [](uint8_t) {};
+
+    coordinator.begin(false);
+    coordinator.clearTags();
+    for (size_t i = 0; i < trace.tags.size(); ++i)
+    {
+        coordinator.addTag(trace.tags[i].data(), static_cast<uint8_t>(trace.tags[i].size()));
+        coordinator.setTransit(static_cast<uint8_t>(i), trace.stats[i]);
+    }
+    for (const IntervalRecord &r : trace.intervals)
+        coordinator.putInterval(r);
+    coordinator.setChangeHook(onChange, nullptr);
+    bt.begin();
+    // After bt.begin(), which registers the firmware's own passage hook.
+    coordinator.setPassageHook(onPassage, nullptr);
+    rfid.begin();
+    if (twoReaders)
+        rfid2.begin();
+    pending.assign(events.begin(), events.end());
+    HostClock::setTickHook(deliver);
+
+    printf("trace reader_bytes=%lu bt_bytes=%lu reader2_bytes=%lu span_s=%.1f tags=%zu intervals=%zu\n",
+           counts[TRACE_RFID], counts[TRACE_BT], counts[TRACE_RFID2], spanMs / 1000.0, trace.tags.size(),
+           trace.intervals.size());
+    if (counts[TRACE_BT])
+        printf("note: trace has BT input; tables are the dump-time ones, so edits replay on top of their own "
+               "result\n");
+    clock_t wallStart = clock();
+    bool rfidOn = !coordinator.isRfidEnabled();
+    DoorMotion motion = static_cast<DoorMotion>(0xFF);
+    unsigned long opens = 0;
+    const uint64_t endMs = startMs + spanMs + TAIL_MS;
+    while (HostClock::nowMs() < endMs)
+    {
+        bt.loop();
+        rfid.loop();
+        if (twoReaders)
+            rfid2.loop();
+        coordinator.loop();
+
+        if (coordinator.isRfidEnabled() != rfidOn)
+        {
+            rfidOn = coordinator.isRfidEnabled();
+            stamp();
+            printf("rfid %s\n", rfidOn ? "on" : "off");
+        }
+        DoorMotion m = coordinator.getDoorMotion();
+        if (m != motion)
+        {
+            static const char *const names[] = {"closed", "opening", "open", "closing"};
+            motion = m;
+            opens += m == DOOR_OPENING;
+            stamp();
+            printf("door %s\n", names[m]);
+        }
+
+        uint64_t now = HostClock::nowMs();
+        if (m == DOOR_CLOSED && !pending.empty() && startMs + pending.front().atMs > now + 1000 &&
+            Serial.available() == 0 && btPort->available() == 0 && readerPort2.available() == 0)
+        {
+            HostClock::set((startMs + pending.front().atMs - 20) * 1000);
+            continue;
+        }
+        // The firmware's 10 ms loop, woken early so each byte is read at the
+        // millisecond the unit read it.
+        uint64_t next = now + 10;
+        if (!pending.empty() && startMs + pending.front().atMs > now && startMs + pending.front().atMs < next)
+            next = startMs + pending.front().atMs;
+        delay(static_cast<unsigned long>(next - now));
+    }
+    double wall = static_cast<double>(clock() - wallStart) / CLOCKS_PER_SEC;
+    printf("replayed %.1f s in %.3f s wall, opens=%lu\n", (spanMs + TAIL_MS) / 1000.0, wall, opens);
+    if (expectOpens < 0)
+        return 0;
+    bool pass = opens == static_cast<unsigned long>(expectOpens);
+    printf("%s: opens=%lu expected=%ld\n", pass ? "PASS" : "FAIL", opens, expectOpens);
+    return pass ? 0 : 1;
+}
@@ -0,0 +1,159 @@
+#pragma once
+// Host-side stand-in for the Arduino core, used by the simulators under sim/.
+// Only the subset of the API that PawPass touches is provided. Time is
+// virtual: millis()/micros() read HostClock and delay() advances it. Like on
+// the AVR they are 32 bits wide, so millis() wraps every 49.7 days; simulators
+// keep their own timeline in HostClock's 64-bit microseconds.
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <strings.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include <deque>
+#include <vector>
+#include <functional>
+#include <avr/pgmspace.h>
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define DEC 10
+#define HEX 16
+#define INPUT 0x0
+#define OUTPUT 0x1
+#define LOW 0x0
+#define HIGH 0x1
+
+class __FlashStringHelper;
+#define F(s) (reinterpret_cast<const __FlashStringHelper *>(s))
+
+namespace HostClock
+{
+    // Current virtual time in microseconds.
+    uint64_t nowUs();
+    inline uint64_t nowMs() { return nowUs() / 1000; }
+    // Advance virtual time, running the tick hook for every elapsed millisecond
+    // boundary so simulated peripherals can deliver bytes while firmware waits.
+    void advanceUs(uint64_t us);
+    void advanceMs(uint64_t ms);
+    void set(uint64_t us);
+    void setTickHook(std::function<void(uint64_t nowMs)> hook);
+}
+
+uint32_t millis();
+uint32_t micros();
+void delay(uint32_t ms);
+void delayMicroseconds(unsigned int us);
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int digitalRead(uint8_t pin);
+
+class Print
+{
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t b) = 0;
+    virtual size_t write(const uint8_t *buf, size_t len)
+    {
+        size_t n = 0;
+        while (len--)
+            n += write(*buf++);
+        return n;
+    }
+    size_t write(const char *s) { return s ? write(reinterpret_cast<const uint8_t *>(s), strlen(s)) : 0; }
+
+    size_t print(const __FlashStringHelper *s) { return write(reinterpret_cast<const char *>(s)); }
+    size_t print(const char *s) { return write(s); }
+    size_t print(char c) { return write(static_cast<uint8_t>(c)); }
+    size_t print(unsigned char v, int base = DEC) { return printNumber(v, base, false); }
+    size_t print(int v, int base = DEC) { return printNumber(v, base, true); }
+    size_t print(unsigned int v, int base = DEC) { return printNumber(v, base, false); }
+    size_t print(long v, int base = DEC) { return printNumber(v, base, true); }
+    size_t print(unsigned long v, int base = DEC) { return printNumber(v, base, false); }
+    size_t print(long long v, int base = DEC) { return printNumber(v, base, true); }
+    size_t print(unsigned long long v, int base = DEC) { return printNumber(v, base, false); }
+    size_t print(signed char v, int base = DEC) { return printNumber(v, base, true); }
+    size_t print(short v, int base = DEC) { return printNumber(v, base, true); }
+    size_t print(unsigned short v, int base = DEC) { return printNumber(v, base, false); }
+    size_t print(bool v) { return printNumber(v ? 1 : 0, DEC, false); }
+
+    size_t println() { return write("\r\n"); }
+    template <typename T>
+    size_t println(T v) { return print(v) + println(); }
+    template <typename T>
+    size_t println(T v, int base) { return print(v, base) + println(); }
+
+private:
+    size_t printNumber(long long v, int base, bool isSigned);
+};
+
+class Stream : public Print
+{
+public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+    virtual void flush() {}
+};
+
+// Byte pipe with an RX queue the simulator fills and a TX log it can drain.
+// The RX queue is bounded like the AVR cores' ring buffers (64 bytes), so
+// firmware that falls behind loses bytes here as it would on the board.
+class HostSerialPort : public Stream
+{
+public:
+    void begin(unsigned long rate) { baud = rate; }
+    void end() {}
+    int available() override { return static_cast<int>(rx.size()); }
+    int read() override
+    {
+        if (rx.empty())
+            return -1;
+        uint8_t b = rx.front();
+        rx.pop_front();
+        return b;
+    }
+    int peek() override { return rx.empty() ? -1 : rx.front(); }
+    using Print::write;
+    size_t write(uint8_t b) override
+    {
+        if (txHook)
+            txHook(b);
+        else if (captureTx)
+            tx.push_back(b);
+        return 1;
+    }
+    operator bool() const { return true; }
+
+    // Host-only helpers.
+    void inject(uint8_t b)
+    {
+        if (rx.size() >= rxCapacity)
+        {
+            ++rxOverflows;
+            return;
+        }
+        rx.push_back(b);
+    }
+    void inject(const uint8_t *buf, size_t len)
+    {
+        while (len--)
+            inject(*buf++);
+    }
+    void inject(const char *s) { inject(reinterpret_cast<const uint8_t *>(s), strlen(s)); }
+    void clearRx() { rx.clear(); }
+    std::deque<uint8_t> rx;
+    std::vector<uint8_t> tx;
+    bool captureTx = false;
+    size_t rxCapacity = 64;
+    unsigned long rxOverflows = 0;
+    std::function<void(uint8_t)> txHook;
+    unsigned long baud = 0;
+};
+
+class HardwareSerial : public HostSerialPort
+{
+};
+
+extern HardwareSerial Serial;
\ No newline at end of file
@@ -0,0 +1,115 @@
+#include <Arduino.h>
+#include <SoftwareSerial.h>
+#include <Servo.h>
+#include <stdio.h>
+
+HardwareSerial Serial;
+
+namespace
+{
+    uint64_t clockUs = 0;
+    std::function<void(uint64_t)> tickHook;
+
+    // Function-local so ports constructed during static init can register.
+    std::vector<SoftwareSerial *> &softPorts()
+    {
+        static std::vector<SoftwareSerial *> ports;
+        return ports;
+    }
+}
+
+uint64_t HostClock::nowUs() { return clockUs; }
+
+void HostClock::advanceUs(uint64_t us)
+{
+    uint64_t target = clockUs + us;
+    if (!tickHook)
+    {
+        clockUs = target;
+        return;
+    }
+    while (clockUs < target)
+    {
+        uint64_t nextMs = (clockUs / 1000 + 1) * 1000;
+        clockUs = nextMs < target ? nextMs : target;
+        if (clockUs % 1000 == 0)
+            tickHook(clockUs / 1000);
+    }
+}
+
+void HostClock::advanceMs(uint64_t ms) { advanceUs(ms * 1000); }
+void HostClock::set(uint64_t us) { clockUs = us; }
+void HostClock::setTickHook(std::function<void(uint64_t)> hook) { tickHook = hook; }
+
+uint32_t millis() { return static_cast<uint32_t>(clockUs / 1000); }
+uint32_t micros() { return static_cast<uint32_t>(clockUs); }
+void delay(uint32_t ms) { HostClock::advanceMs(ms); }
+void delayMicroseconds(unsigned int us) { HostClock::advanceUs(us); }
+void pinMode(uint8_t, uint8_t) {}
+void digitalWrite(uint8_t, uint8_t) {}
+int digitalRead(uint8_t) { return LOW; }
+
+size_t Print::printNumber(long long v, int base, bool isSigned)
+{
+    char buf[32];
+    if (base == HEX)
+        snprintf(buf, sizeof(buf), "%llX", static_cast<unsigned long long>(v));
+    else if (isSigned)
+        snprintf(buf, sizeof(buf), "%lld", v);
+    else
+        snprintf(buf, sizeof(buf), "%llu", static_cast<unsigned long long>(v));
+    return write(buf);
+}
+
+SoftwareSerial::SoftwareSerial(uint8_t rxPin, uint8_t, bool) : rx_(rxPin)
+{
+    softPorts().push_back(this);
+}
+
+SoftwareSerial::~SoftwareSerial()
+{
+    std::vector<SoftwareSerial *> &ports = softPorts();
+    for (size_t i = 0; i < ports.size(); ++i)
+    {
+        if (ports[i] == this)
+        {
+            ports.erase(ports.begin() + i);
+            break;
+        }
+    }
+}
+
+SoftwareSerial *SoftwareSerial::findByRxPin(uint8_t rxPin)
+{
+    for (SoftwareSerial *p : softPorts())
+    {
+        if (p->rxPin() == rxPin)
+            return p;
+    }
+    return nullptr;
+}
+
+std::function<void(const Servo &, int, bool)> Servo::hook;
+
+uint8_t Servo::attach(int p)
+{
+    pin = p;
+    isAttached = true;
+    if (hook)
+        hook(*this, pulseUs, isAttached);
+    return 0;
+}
+
+void Servo::detach()
+{
+    isAttached = false;
+    if (hook)
+        hook(*this, pulseUs, isAttached);
+}
+
+void Servo::writeMicroseconds(int us)
+{
+    pulseUs = us;
+    if (hook)
+        hook(*this, pulseUs, isAttached);
+}
\ No newline at end of file
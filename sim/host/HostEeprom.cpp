@@ -0,0 +1,175 @@
+#include "HostEeprom.h"
+#include <Arduino.h>
+#include <string.h>
+
+// Defined by the firmware's ISR(EE_READY_vect) when it is linked in.
+extern "C" void EE_READY_vect() __attribute__((weak));
+
+namespace
+{
+    constexpr uint8_t BIT_EERE = 0x01;
+    constexpr uint8_t BIT_EEPE = 0x02;
+    constexpr uint8_t BIT_EEMPE = 0x04;
+    constexpr uint8_t BIT_EERIE = 0x08;
+
+    uint8_t memory[HostEeprom::SIZE];
+    bool erased = false;
+    uint8_t eecr = 0;
+    uint8_t eedr = 0;
+    uint16_t eear = 0;
+    bool masterEnabled = false; // EEMPE written by the previous EECR write
+    bool busy = false;
+    uint64_t doneUs = 0;
+    uint16_t progAddr = 0;
+    uint8_t progValue = 0;
+    uint32_t programmed = 0;
+    bool powered = true;
+    unsigned irqOff = 0;
+    bool inService = false;
+
+    void ensureErased()
+    {
+        if (!erased)
+            HostEeprom::erase();
+    }
+
+    void finishProgramming()
+    {
+        if (powered)
+            memory[progAddr % HostEeprom::SIZE] = progValue;
+        busy = false;
+    }
+
+    // Skips the clock to the end of programming without running the tick
+    // hook: nothing else happens while the CPU is halted.
+    void waitReady()
+    {
+        if (!busy)
+            return;
+        if (doneUs > HostClock::nowUs())
+            HostClock::set(doneUs);
+        finishProgramming();
+    }
+}
+
+namespace HostEeprom
+{
+    void erase()
+    {
+        memset(memory, 0xFF, sizeof(memory));
+        erased = true;
+        busy = false;
+        programmed = 0;
+    }
+
+    uint8_t peek(uint16_t addr)
+    {
+        ensureErased();
+        return memory[addr % SIZE];
+    }
+
+    bool programming() { return busy; }
+    uint32_t programCount() { return programmed; }
+
+    void powerCut()
+    {
+        ensureErased();
+        if (busy)
+        {
+            memory[progAddr % SIZE] = 0xFF; // erased, not yet written
+            busy = false;
+        }
+        powered = false;
+    }
+
+    void powerOn()
+    {
+        busy = false;
+        eecr = 0;
+        masterEnabled = false;
+        powered = true;
+    }
+
+    void service()
+    {
+        if (inService)
+            return;
+        inService = true;
+        if (busy && HostClock::nowUs() >= doneUs)
+            finishProgramming();
+        if (!busy && (eecr & BIT_EERIE) && irqOff == 0 && EE_READY_vect)
+        {
+            // The I bit is clear inside an ISR.
+            ++irqOff;
+            EE_READY_vect();
+            --irqOff;
+        }
+        inService = false;
+    }
+
+    void disableInterrupts() { ++irqOff; }
+
+    void enableInterrupts()
+    {
+        if (--irqOff == 0)
+            service();
+    }
+
+    uint16_t readRegister(RegisterId r)
+    {
+        switch (r)
+        {
+        case REG_EECR:
+            // A polling loop costs time, so a spin on EEPE makes progress.
+            HostClock::advanceUs(1);
+            service();
+            return static_cast<uint16_t>((eecr & BIT_EERIE) | (busy ? BIT_EEPE : 0));
+        case REG_EEDR:
+            return eedr;
+        case REG_EEAR:
+            return eear;
+        }
+        return 0;
+    }
+
+    void writeRegister(RegisterId r, uint16_t v)
+    {
+        ensureErased();
+        switch (r)
+        {
+        case REG_EEDR:
+            eedr = static_cast<uint8_t>(v);
+            return;
+        case REG_EEAR:
+            eear = static_cast<uint16_t>(v % SIZE);
+            return;
+        case REG_EECR:
+            break;
+        }
+        bool master = masterEnabled;
+        masterEnabled = false;
+        eecr = static_cast<uint8_t>(v & BIT_EERIE);
+        if (v & BIT_EERE)
+        {
+            waitReady(); // the CPU halts until the byte is done
+            eedr = memory[eear];
+        }
+        if (v & BIT_EEMPE)
+            masterEnabled = true;
+        if ((v & BIT_EEPE) && master && !busy)
+        {
+            busy = true;
+            progAddr = eear;
+            progValue = eedr;
+            doneUs = HostClock::nowUs() + (powered ? PROGRAM_US : 0);
+            ++programmed;
+        }
+    }
+
+    uint8_t readByte(uint16_t addr)
+    {
+        ensureErased();
+        waitReady();
+        return memory[addr % SIZE];
+    }
+}
@@ -0,0 +1,64 @@
+#pragma once
+// Host model of the ATmega328P EEPROM (1 KB) behind the avr/io.h,
+// avr/eeprom.h, avr/interrupt.h and util/atomic.h stand-ins, for the storage
+// simulator (sim/EepromSim.cpp). EECR follows the datasheet: EERE strobes a
+// read into EEDR, EEPE starts programming only right after EEMPE, and a byte
+// takes PROGRAM_US of virtual time, during which EEPE reads 1 and reads of
+// the array stall. The EE_READY interrupt runs from service(), which every
+// register read and the simulator's tick hook call, whenever EERIE is set,
+// EEPE is clear and no ATOMIC_BLOCK is open (it also runs as a block ends,
+// like a pending interrupt).
+#include <stdint.h>
+
+namespace HostEeprom
+{
+    constexpr uint16_t SIZE = 1024;
+    constexpr uint32_t PROGRAM_US = 3400;
+
+    enum RegisterId : uint8_t
+    {
+        REG_EECR,
+        REG_EEDR,
+        REG_EEAR,
+    };
+
+    uint16_t readRegister(RegisterId r);
+    void writeRegister(RegisterId r, uint16_t v);
+
+    // Reads like the register, writes have the register's side effects.
+    class Register
+    {
+    public:
+        explicit constexpr Register(RegisterId which) : id(which) {}
+        operator uint16_t() const { return readRegister(id); }
+        const Register &operator=(uint16_t v) const
+        {
+            writeRegister(id, v);
+            return *this;
+        }
+        const Register &operator|=(uint16_t v) const { return *this = readRegister(id) | v; }
+        const Register &operator&=(uint16_t v) const { return *this = readRegister(id) & v; }
+
+    private:
+        RegisterId id;
+    };
+
+    // Completes programming that is due and runs the EE_READY interrupt.
+    void service();
+    void disableInterrupts();
+    void enableInterrupts();
+    // eeprom_read_byte(): waits out programming in progress.
+    uint8_t readByte(uint16_t addr);
+
+    // Simulator side. Fresh parts read 0xFF.
+    void erase();
+    uint8_t peek(uint16_t addr);
+    bool programming();
+    // Bytes programmed since erase().
+    uint32_t programCount();
+    // Power fails now: the byte being programmed is left erased. Until
+    // powerOn(), EEPE completes at once without touching the array, so the
+    // firmware's RAM queue can be drained as if it had been lost.
+    void powerCut();
+    void powerOn();
+}
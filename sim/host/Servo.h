@@ -0,0 +1,23 @@
+#pragma once
+// Host stand-in for the Servo library. Every pulse update is forwarded to an
+// optional hook so simulators can timestamp door commands.
+#include <Arduino.h>
+
+class Servo
+{
+public:
+    uint8_t attach(int pin);
+    void detach();
+    void writeMicroseconds(int us);
+    void write(int angle) { writeMicroseconds(544 + (angle * (2400 - 544)) / 180); }
+    int readMicroseconds() const { return pulseUs; }
+    bool attached() const { return isAttached; }
+
+    // Host-only: called as hook(servo, pulseUs, attached) after every change.
+    static std::function<void(const Servo &, int, bool)> hook;
+
+private:
+    int pin = -1;
+    int pulseUs = 1500;
+    bool isAttached = false;
+};
\ No newline at end of file
@@ -0,0 +1,23 @@
+#pragma once
+// Host stand-in for SoftwareSerial. Instances register themselves by RX pin so
+// a simulator can reach the port a module constructed internally.
+#include <Arduino.h>
+
+#ifndef _SS_MAX_RX_BUFF
+#define _SS_MAX_RX_BUFF 64
+#endif
+
+class SoftwareSerial : public HostSerialPort
+{
+public:
+    SoftwareSerial(uint8_t rxPin, uint8_t txPin, bool inverse = false);
+    ~SoftwareSerial();
+    bool listen() { return true; }
+    bool isListening() const { return true; }
+    uint8_t rxPin() const { return rx_; }
+
+    static SoftwareSerial *findByRxPin(uint8_t rxPin);
+
+private:
+    uint8_t rx_;
+};
\ No newline at end of file
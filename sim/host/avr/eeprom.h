@@ -0,0 +1,9 @@
+#pragma once
+// Host stand-in: array reads through HostEeprom.
+#include <stdint.h>
+#include "../HostEeprom.h"
+
+inline uint8_t eeprom_read_byte(const uint8_t *addr)
+{
+    return HostEeprom::readByte(static_cast<uint16_t>(reinterpret_cast<uintptr_t>(addr)));
+}
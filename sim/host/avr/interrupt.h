@@ -0,0 +1,5 @@
+#pragma once
+// Host stand-in: a vector is a plain function HostEeprom::service() calls.
+#include "../HostEeprom.h"
+
+#define ISR(vect) extern "C" void vect()
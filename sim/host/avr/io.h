@@ -0,0 +1,16 @@
+#pragma once
+// Host stand-in: the EEPROM registers of the ATmega328P, modelled by
+// HostEeprom.
+#include <stdint.h>
+#include "../HostEeprom.h"
+
+#define E2END 0x3FF
+#define EERE 0
+#define EEPE 1
+#define EEMPE 2
+#define EERIE 3
+#define _BV(bit) (1u << (bit))
+
+#define EECR (HostEeprom::Register(HostEeprom::REG_EECR))
+#define EEDR (HostEeprom::Register(HostEeprom::REG_EEDR))
+#define EEAR (HostEeprom::Register(HostEeprom::REG_EEAR))
@@ -0,0 +1,17 @@
+#pragma once
+// Host stand-in: program memory is ordinary memory.
+#include <string.h>
+#include <strings.h>
+#include <stdint.h>
+
+#define PROGMEM
+#define PGM_P const char *
+#define PSTR(s) (s)
+#define pgm_read_byte(addr) (*reinterpret_cast<const uint8_t *>(addr))
+#define pgm_read_word(addr) (*reinterpret_cast<const uint16_t *>(addr))
+#define pgm_read_ptr(addr) (*reinterpret_cast<void *const *>(addr))
+#define memcpy_P memcpy
+#define strcmp_P strcmp
+#define strcasecmp_P strcasecmp
+#define strncasecmp_P strncasecmp
+#define strlen_P strlen
\ No newline at end of file
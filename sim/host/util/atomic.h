@@ -0,0 +1,14 @@
+#pragma once
+// Host stand-in: ATOMIC_BLOCK holds off HostEeprom's interrupt; one that
+// became pending runs as the block ends.
+#include "../HostEeprom.h"
+
+#define ATOMIC_RESTORESTATE 0
+
+struct HostAtomicGuard
+{
+    HostAtomicGuard() { HostEeprom::disableInterrupts(); }
+    ~HostAtomicGuard() { HostEeprom::enableInterrupts(); }
+};
+
+#define ATOMIC_BLOCK(type) for (HostAtomicGuard _guard, *_once = &_guard; _once; _once = nullptr)
@@ -0,0 +1,473 @@
+#include "Bus/DoorBus.h"
+#include <string.h>
+
+static constexpr uint8_t BUS_SOF = 0xA5;
+
+enum BusFrameType : uint8_t
+{
+    BUS_POLL = 0x01,       // primary -> replica: <seq>
+    BUS_STATUS = 0x02,     // replica -> primary: <applied seq> <needSync>
+    BUS_SYNC_BEGIN = 0x03, // primary -> replica: full table transfer follows
+    BUS_SYNC_END = 0x04,   // primary -> replica: <seq the snapshot is based on> <items>
+    BUS_TAG_ADD = 0x10,    // <len> <id...>
+    BUS_TAG_DEL = 0x11,    // <len> <id...>
+    BUS_IV_SET = 0x12,     // <idLen> <id...> <start16> <end16> <days> <enabled>
+    BUS_IV_DEL = 0x13,     // <idLen> <id...>
+    BUS_SNAPSHOT = 0x80,   // or-ed into change types sent inside a full sync
+};
+
+DoorBus::DoorBus(SystemCoordinator &coord, Stream &busPort, uint8_t busAddress, uint8_t nodes, uint8_t rs485DePin)
+    : coordinator(coord), port(busPort), address(busAddress),
+      nodeCount(nodes > BUS_MAX_NODES ? BUS_MAX_NODES : nodes), dePin(rs485DePin)
+{
+}
+
+void DoorBus::begin()
+{
+    if (dePin != 0xFF)
+    {
+        pinMode(dePin, OUTPUT);
+        digitalWrite(dePin, LOW);
+    }
+    rxIndex = 0;
+    seq = 0;
+    broadcastSeq = 0;
+    journalCount = 0;
+    syncedMask = 0;
+    pollAddr = 0;
+    awaitingReply = false;
+    xferMode = XFER_NONE;
+    synced = isPrimary();
+    syncing = false;
+    lastPollMs = millis();
+    coordinator.setReplica(!isPrimary());
+    if (isPrimary())
+        coordinator.setChangeHook(&DoorBus::onCoordinatorChange, this);
+#if DEBUG_MODE
+    DBG_S("[BUS] addr=");
+    DBG_VL(address);
+#endif
+}
+
+uint16_t DoorBus::crc16(const uint8_t *data, uint8_t len)
+{
+    // CRC-16/CCITT-FALSE, byte-wise form of avr-libc's _crc_ccitt_update().
+    // An 8-bit CRC is not enough here: a dropped byte makes the length field
+    // swallow part of the next frame, and 1 in 256 of those would pass.
+    uint16_t crc = 0xFFFF;
+    while (len--)
+    {
+        uint8_t x = static_cast<uint8_t>((crc >> 8) ^ *data++);
+        x ^= x >> 4;
+        crc = static_cast<uint16_t>((crc << 8) ^ (static_cast<uint16_t>(x) << 12) ^ (static_cast<uint16_t>(x) << 5) ^ x);
+    }
+    return crc;
+}
+
+void DoorBus::onCoordinatorChange(void *ctx, CoordinatorChange kind, const uint8_t *key, uint8_t keyLen)
+{
+    DoorBus *self = static_cast<DoorBus *>(ctx);
+    if (keyLen > MAX_TAG_ID_LEN)
+        keyLen = MAX_TAG_ID_LEN;
+    ++self->seq;
+    JournalEntry &e = self->journal[self->seq % BUS_JOURNAL_SIZE];
+    e.kind = kind;
+    e.len = keyLen;
+    memcpy(e.key, key, keyLen);
+    if (self->journalCount < BUS_JOURNAL_SIZE)
+        ++self->journalCount;
+    if (static_cast<uint8_t>(self->seq - self->broadcastSeq) > BUS_JOURNAL_SIZE)
+    {
+        // Edits outran the bus: the oldest unsent change is gone, so every
+        // replica has to take a full snapshot instead.
+        self->broadcastSeq = self->seq;
+        self->syncedMask = 0;
+    }
+}
+
+void DoorBus::sendFrame(uint8_t dst, uint8_t frameSeq, uint8_t type, const uint8_t *payload, uint8_t len)
+{
+    uint8_t frame[MAX_PAYLOAD + 8];
+    frame[0] = BUS_SOF;
+    frame[1] = dst;
+    frame[2] = address;
+    frame[3] = frameSeq;
+    frame[4] = type;
+    frame[5] = len;
+    if (len)
+        memcpy(frame + 6, payload, len);
+    uint16_t crc = crc16(frame + 1, 5 + len);
+    frame[6 + len] = crc & 0xFF;
+    frame[7 + len] = crc >> 8;
+    if (dePin != 0xFF)
+        digitalWrite(dePin, HIGH);
+    port.write(frame, 8 + len);
+    if (dePin != 0xFF)
+    {
+        port.flush();
+        digitalWrite(dePin, LOW);
+    }
+}
+
+void DoorBus::sendTag(uint8_t dst, uint8_t frameSeq, uint8_t type, const uint8_t *id, uint8_t len)
+{
+    uint8_t payload[1 + MAX_TAG_ID_LEN];
+    payload[0] = len;
+    memcpy(payload + 1, id, len);
+    sendFrame(dst, frameSeq, type, payload, 1 + len);
+}
+
+void DoorBus::sendInterval(uint8_t dst, uint8_t frameSeq, uint8_t type, const char *id)
+{
+    uint8_t payload[MAX_PAYLOAD];
+    uint8_t idLen = strnlen(id, sizeof(IntervalRecord::id) - 1);
+    payload[0] = idLen;
+    memcpy(payload + 1, id, idLen);
+    const IntervalRecord *rec = coordinator.findInterval(id);
+    if ((type & ~BUS_SNAPSHOT) == BUS_IV_DEL || !rec)
+    {
+        sendFrame(dst, frameSeq, (type & BUS_SNAPSHOT) | BUS_IV_DEL, payload, 1 + idLen);
+        return;
+    }
+    uint8_t *p = payload + 1 + idLen;
+    *p++ = rec->startMin & 0xFF;
+    *p++ = rec->startMin >> 8;
+    *p++ = rec->endMin & 0xFF;
+    *p++ = rec->endMin >> 8;
+    *p++ = rec->daysMask;
+    *p++ = rec->enabled ? 1 : 0;
+    sendFrame(dst, frameSeq, type, payload, p - payload);
+}
+
+void DoorBus::sendJournalEntry(uint8_t dst, uint8_t entrySeq)
+{
+    const JournalEntry &e = journal[entrySeq % BUS_JOURNAL_SIZE];
+    switch (e.kind)
+    {
+    case CHANGE_TAG_ADDED:
+        sendTag(dst, entrySeq, BUS_TAG_ADD, e.key, e.len);
+        break;
+    case CHANGE_TAG_REMOVED:
+        sendTag(dst, entrySeq, BUS_TAG_DEL, e.key, e.len);
+        break;
+    case CHANGE_INTERVAL_SET:
+    case CHANGE_INTERVAL_DELETED:
+    {
+        char id[sizeof(IntervalRecord::id)];
+        memcpy(id, e.key, e.len);
+        id[e.len < sizeof(id) ? e.len : sizeof(id) - 1] = '\0';
+        // Sent with the record as it is now; a later delete has its own entry.
+        sendInterval(dst, entrySeq, e.kind == CHANGE_INTERVAL_SET ? BUS_IV_SET : BUS_IV_DEL, id);
+        break;
+    }
+    }
+}
+
+bool DoorBus::journalCovers(uint8_t fromSeq) const
+{
+    uint8_t needed = static_cast<uint8_t>(seq - fromSeq + 1);
+    return needed <= journalCount;
+}
+
+void DoorBus::startTransfer(uint8_t node, uint8_t appliedSeq, bool needFull)
+{
+    if (xferMode != XFER_NONE)
+        return; // busy; the node is asked again on its next poll
+    if (!needFull && appliedSeq == seq)
+        return;
+    xferNode = node;
+    xferEndSeq = seq;
+    if (!needFull && journalCovers(static_cast<uint8_t>(appliedSeq + 1)))
+    {
+        xferMode = XFER_CATCHUP;
+        xferCursor = appliedSeq + 1;
+        ++catchUps;
+    }
+    else
+    {
+        xferMode = XFER_FULL;
+        xferCursor = 0;
+        ++fullSyncs;
+    }
+#if DEBUG_MODE
+    DBG_S("[BUS] xfer node=");
+    DBG_V(node);
+    if (xferMode == XFER_FULL)
+        DBG_SL(" full");
+    else
+        DBG_SL(" catchup");
+#endif
+}
+
+void DoorBus::stepTransfer()
+{
+    if (xferMode == XFER_CATCHUP)
+    {
+        if (!journalCovers(xferCursor))
+        {
+            // Overwritten while we were sending; fall back to a snapshot.
+            xferMode = XFER_FULL;
+            xferCursor = 0;
+            xferEndSeq = seq;
+            ++fullSyncs;
+            return;
+        }
+        sendJournalEntry(xferNode, xferCursor);
+        if (xferCursor == xferEndSeq)
+            xferMode = XFER_NONE;
+        ++xferCursor;
+        return;
+    }
+
+    // Full snapshot: BEGIN, every tag, every interval, END(seq at start).
+    // Items are read live, so edits made meanwhile may already be included;
+    // replaying their journal entries afterwards is harmless.
+    uint8_t c = xferCursor++;
+    if (c == 0)
+    {
+        sendFrame(xferNode, seq, BUS_SYNC_BEGIN, nullptr, 0);
+        return;
+    }
+    --c;
+    if (c < coordinator.getNumTags())
+    {
+        uint8_t len;
+        const uint8_t *id = coordinator.getTag(c, len);
+        sendTag(xferNode, seq, BUS_TAG_ADD | BUS_SNAPSHOT, id, len);
+        return;
+    }
+    c -= coordinator.getNumTags();
+    if (c < coordinator.getIntervalCount())
+    {
+        sendInterval(xferNode, seq, BUS_IV_SET | BUS_SNAPSHOT, coordinator.getInterval(c)->id);
+        return;
+    }
+    // The item count lets the replica notice a snapshot frame lost on the wire.
+    uint8_t end[2] = {xferEndSeq, static_cast<uint8_t>(xferCursor - 2)};
+    sendFrame(xferNode, seq, BUS_SYNC_END, end, sizeof(end));
+    syncedMask |= static_cast<uint8_t>(1u << xferNode);
+    xferMode = XFER_NONE;
+}
+
+// <idLen> <id...> <start16> <end16> <days> <enabled>; false if malformed.
+static bool decodeInterval(const uint8_t *payload, uint8_t len, IntervalRecord &rec)
+{
+    uint8_t keyLen = payload[0];
+    memset(&rec, 0, sizeof(rec));
+    if (keyLen >= sizeof(rec.id) || len < 1 + keyLen + 6)
+        return false;
+    memcpy(rec.id, payload + 1, keyLen);
+    const uint8_t *p = payload + 1 + keyLen;
+    rec.startMin = p[0] | (p[1] << 8);
+    rec.endMin = p[2] | (p[3] << 8);
+    rec.daysMask = p[4];
+    rec.enabled = p[5] != 0;
+    return true;
+}
+
+void DoorBus::applyChange(uint8_t type, const uint8_t *payload, uint8_t len)
+{
+    if (len < 1 || payload[0] + 1 > len)
+        return;
+    uint8_t keyLen = payload[0];
+    const uint8_t *key = payload + 1;
+    switch (type)
+    {
+    case BUS_TAG_ADD:
+        if (coordinator.findTagIndex(key, keyLen) < 0)
+            coordinator.addTag(key, keyLen);
+        break;
+    case BUS_TAG_DEL:
+        coordinator.removeTag(key, keyLen);
+        break;
+    case BUS_IV_SET:
+    {
+        IntervalRecord rec;
+        if (decodeInterval(payload, len, rec))
+            coordinator.putInterval(rec);
+        break;
+    }
+    case BUS_IV_DEL:
+    {
+        char id[sizeof(IntervalRecord::id)];
+        if (keyLen >= sizeof(id))
+            return;
+        memcpy(id, key, keyLen);
+        id[keyLen] = '\0';
+        coordinator.deleteInterval(id);
+        break;
+    }
+    }
+}
+
+void DoorBus::stageItem(uint8_t type, const uint8_t *payload, uint8_t len)
+{
+    if (len < 1 || payload[0] + 1 > len)
+        return;
+    if (type == BUS_TAG_ADD && payload[0] <= MAX_TAG_ID_LEN && stagedTagCount < MAX_TAGS)
+    {
+        StagedTag &t = stagedTags[stagedTagCount++];
+        t.len = payload[0];
+        memcpy(t.id, payload + 1, t.len);
+    }
+    else if (type == BUS_IV_SET && stagedIntervalCount < MAX_INTERVALS &&
+             decodeInterval(payload, len, stagedIntervals[stagedIntervalCount]))
+    {
+        ++stagedIntervalCount;
+    }
+}
+
+void DoorBus::commitSnapshot()
+{
+    coordinator.clearTags();
+    coordinator.clearIntervals();
+    for (uint8_t i = 0; i < stagedTagCount; ++i)
+        coordinator.addTag(stagedTags[i].id, stagedTags[i].len);
+    for (uint8_t i = 0; i < stagedIntervalCount; ++i)
+        coordinator.putInterval(stagedIntervals[i]);
+}
+
+void DoorBus::handleFrame(uint8_t src, uint8_t frameSeq, uint8_t type, const uint8_t *payload, uint8_t len)
+{
+    if (isPrimary())
+    {
+        if (type == BUS_STATUS && awaitingReply && src == pollAddr && len >= 2)
+        {
+            awaitingReply = false;
+            bool known = (syncedMask & (1u << src)) != 0;
+            startTransfer(src, payload[0], payload[1] != 0 || !known);
+        }
+        return;
+    }
+
+    if (src != BUS_PRIMARY_ADDRESS)
+        return;
+    switch (type)
+    {
+    case BUS_POLL:
+    {
+        uint8_t status[2] = {seq, static_cast<uint8_t>(synced ? 0 : 1)};
+        sendFrame(BUS_PRIMARY_ADDRESS, seq, BUS_STATUS, status, sizeof(status));
+        break;
+    }
+    case BUS_SYNC_BEGIN:
+        // The live tables stay in use until the snapshot is complete.
+        syncing = true;
+        synced = false;
+        syncItems = 0;
+        stagedTagCount = 0;
+        stagedIntervalCount = 0;
+        break;
+    case BUS_SYNC_END:
+        if (syncing && len >= 2 && payload[1] != syncItems)
+        {
+            // Incomplete snapshot: dropped, the old tables stay, and staying
+            // unsynced makes the next poll ask again.
+            syncing = false;
+        }
+        else if (syncing && len >= 2)
+        {
+            commitSnapshot();
+            seq = payload[0];
+            synced = true;
+            syncing = false;
+#if DEBUG_MODE
+            DBG_S("[BUS] synced seq=");
+            DBG_VL(seq);
+#endif
+        }
+        break;
+    default:
+        if (type & BUS_SNAPSHOT)
+        {
+            if (syncing)
+            {
+                stageItem(type & ~BUS_SNAPSHOT, payload, len);
+                ++syncItems;
+            }
+        }
+        else if (synced && frameSeq == static_cast<uint8_t>(seq + 1))
+        {
+            applyChange(type, payload, len);
+            seq = frameSeq;
+        }
+        break;
+    }
+}
+
+void DoorBus::receiveByte(uint8_t b)
+{
+    uint32_t now = millis();
+    if (rxIndex > 0 && (now - rxLastByteMs) > BUS_FRAME_GAP_MS)
+        rxIndex = 0;
+    rxLastByteMs = now;
+
+    if (rxIndex == 0 && b != BUS_SOF)
+        return;
+    rxBuf[rxIndex++] = b;
+    if (rxIndex < 6)
+        return;
+    uint8_t len = rxBuf[5];
+    if (len > MAX_PAYLOAD)
+    {
+        rxIndex = 0;
+        return;
+    }
+    if (rxIndex < 8 + len)
+        return;
+    rxIndex = 0;
+
+    uint16_t crc = rxBuf[6 + len] | (rxBuf[7 + len] << 8);
+    if (crc16(rxBuf + 1, 5 + len) != crc)
+    {
+        ++crcErrors;
+        return;
+    }
+    uint8_t dst = rxBuf[1];
+    uint8_t src = rxBuf[2];
+    if (src == address || (dst != address && dst != BUS_BROADCAST))
+        return;
+    handleFrame(src, rxBuf[3], rxBuf[4], rxBuf + 6, len);
+}
+
+void DoorBus::primaryLoop(uint32_t now)
+{
+    if (awaitingReply)
+    {
+        if ((now - lastPollMs) < BUS_REPLY_TIMEOUT_MS)
+            return;
+        awaitingReply = false;
+        ++timeouts;
+    }
+    if (broadcastSeq != seq)
+    {
+        ++broadcastSeq;
+        sendJournalEntry(BUS_BROADCAST, broadcastSeq);
+        return;
+    }
+    if (xferMode != XFER_NONE)
+    {
+        stepTransfer();
+        return;
+    }
+    if (nodeCount > 1 && (now - lastPollMs) >= BUS_POLL_PERIOD_MS)
+    {
+        pollAddr = (pollAddr + 1 < nodeCount) ? pollAddr + 1 : 1;
+        lastPollMs = now;
+        awaitingReply = true;
+        sendFrame(pollAddr, seq, BUS_POLL, &seq, 1);
+    }
+}
+
+void DoorBus::loop()
+{
+    while (port.available() > 0)
+    {
+        int in = port.read();
+        if (in < 0)
+            break;
+        receiveByte(static_cast<uint8_t>(in));
+    }
+    if (isPrimary())
+        primaryLoop(millis());
+}
\ No newline at end of file
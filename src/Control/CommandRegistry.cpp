@@ -0,0 +1,316 @@
+#include "Control/CommandRegistry.h"
+#include <avr/pgmspace.h>
+#include <ctype.h>
+#include <string.h>
+
+static uint8_t argTypeAt(uint16_t schema, uint8_t i)
+{
+    return (schema >> (4 * i)) & 0x0F;
+}
+
+static char *nextToken(char *&p)
+{
+    while (*p && isspace((unsigned char)*p))
+        ++p;
+    if (!*p)
+        return nullptr;
+    char *start = p;
+    while (*p && !isspace((unsigned char)*p))
+        ++p;
+    if (*p)
+        *p++ = '\0';
+    return start;
+}
+
+// Everything left on the line, trailing blanks removed.
+static char *restOfLine(char *&p)
+{
+    while (*p && isspace((unsigned char)*p))
+        ++p;
+    if (!*p)
+        return nullptr;
+    char *start = p;
+    char *end = p + strlen(p);
+    while (end > start && isspace((unsigned char)end[-1]))
+        --end;
+    *end = '\0';
+    p = end;
+    return start;
+}
+
+static bool parseTime(const char *t, uint16_t &minutes)
+{
+    size_t n = strlen(t);
+    if (n < 2 || n > 5)
+        return false;
+    char suf = tolower((unsigned char)t[n - 1]);
+    if (suf != 'a' && suf != 'p')
+        return false;
+    uint16_t v = 0;
+    for (size_t i = 0; i + 1 < n; ++i)
+    {
+        if (!isdigit((unsigned char)t[i]))
+            return false;
+        v = v * 10 + (t[i] - '0');
+    }
+    uint8_t hh = v / 100;
+    uint8_t mm = v % 100;
+    if (hh > 12 || mm > 59)
+        return false;
+    if (suf == 'p' && hh != 12)
+        hh += 12;
+    if (suf == 'a' && hh == 12)
+        hh = 0;
+    minutes = hh * 60 + mm;
+    return true;
+}
+
+// "[1, 3, 5]", brackets optional; 1..6 = Mon..Sat, 7 = Sunday (bit 0).
+static bool parseDays(const char *t, uint16_t &mask)
+{
+    mask = 0;
+    const char *p = t;
+    if (*p == '[')
+        ++p;
+    while (*p && *p != ']')
+    {
+        if (isspace((unsigned char)*p) || *p == ',')
+        {
+            ++p;
+            continue;
+        }
+        if (*p < '1' || *p > '7' || isdigit((unsigned char)p[1]))
+            return false;
+        uint8_t d = *p++ - '0';
+        mask |= (d == 7) ? 1u : (1u << d);
+    }
+    if (*p == ']' && p[1] != '\0')
+        return false;
+    return mask != 0;
+}
+
+static bool parseBool(const char *t, uint16_t &value)
+{
+    if (strcasecmp(t, "true") == 0 || strcmp(t, "1") == 0 || strcasecmp(t, "on") == 0)
+        value = 1;
+    else if (strcasecmp(t, "false") == 0 || strcmp(t, "0") == 0 || strcasecmp(t, "off") == 0)
+        value = 0;
+    else
+        return false;
+    return true;
+}
+
+static CommandStatus parseArg(uint8_t type, char *tok, CommandArg &out)
+{
+    out.text = tok;
+    out.present = true;
+    out.value = 0;
+    switch (type & ~ARG_OPTIONAL)
+    {
+    case ARG_ID:
+        return (strlen(tok) < sizeof(IntervalRecord::id)) ? CMD_OK : CMD_ERR_VALUE;
+    case ARG_TIME:
+        return parseTime(tok, out.value) ? CMD_OK : CMD_ERR_VALUE;
+    case ARG_DAYS:
+        return parseDays(tok, out.value) ? CMD_OK : CMD_ERR_VALUE;
+    case ARG_BOOL:
+        return parseBool(tok, out.value) ? CMD_OK : CMD_ERR_VALUE;
+    default:
+        return CMD_OK;
+    }
+}
+
+// First entry whose name is >= key.
+static uint8_t lowerBound(const char *key)
+{
+    uint8_t lo = 0;
+    uint8_t hi = COMMAND_COUNT;
+    while (lo < hi)
+    {
+        uint8_t mid = (lo + hi) / 2;
+        if (strcasecmp_P(key, COMMANDS[mid].name) > 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+int8_t CommandRegistry::find(const char *name)
+{
+    uint8_t i = lowerBound(name);
+    if (i < COMMAND_COUNT && strcasecmp_P(name, COMMANDS[i].name) == 0)
+        return static_cast<int8_t>(i);
+    return -1;
+}
+
+CommandStatus CommandRegistry::invoke(uint8_t index, CommandContext &ctx, const CommandArgs &args)
+{
+    if (index >= COMMAND_COUNT)
+        return CMD_ERR_UNKNOWN;
+    // A replica's tables belong to the bus primary; a local edit would be
+    // overwritten by the next sync, or worse, survive a primary outage.
+    if ((pgm_read_byte(&COMMANDS[index].flags) & CMD_EDITS_TABLES) && ctx.coordinator.isReplica())
+        return CMD_ERR_REPLICA;
+    CommandHandler handler;
+    memcpy_P(&handler, &COMMANDS[index].handler, sizeof(handler));
+    return handler(ctx, args);
+}
+
+// Resolves cmd (and its selector keyword, if the command family has one)
+// to a table index. Tokens up to the selector are collected into pre[].
+static int8_t resolve(const char *cmd, char *&p, char *pre[], uint8_t &preCount)
+{
+    preCount = 0;
+    int8_t idx = CommandRegistry::find(cmd);
+    if (idx >= 0)
+        return idx;
+    char key[sizeof(CommandDef::name)];
+    size_t n = strlen(cmd);
+    if (n + 2 >= sizeof(key))
+        return -1;
+    memcpy(key, cmd, n);
+    key[n] = ' ';
+    key[n + 1] = '\0';
+    uint8_t first = lowerBound(key);
+    if (first >= COMMAND_COUNT || strncasecmp_P(key, COMMANDS[first].name, n + 1) != 0)
+        return -1;
+    // Every entry of a family has its selector at the same position.
+    uint16_t schema = pgm_read_word(&COMMANDS[first].schema);
+    uint8_t sel = 0;
+    while (sel < COMMAND_MAX_ARGS && argTypeAt(schema, sel) != ARG_SELECT)
+        ++sel;
+    if (sel == COMMAND_MAX_ARGS)
+        return -1;
+    for (; preCount <= sel; ++preCount)
+    {
+        pre[preCount] = nextToken(p);
+        if (!pre[preCount])
+            return -1;
+    }
+    const char *word = pre[sel];
+    size_t w = strlen(word);
+    if (n + 1 + w >= sizeof(key))
+        return -1;
+    memcpy(key + n + 1, word, w + 1);
+    return CommandRegistry::find(key);
+}
+
+CommandStatus CommandRegistry::execute(char *line, CommandContext &ctx)
+{
+    char *p = line;
+    char *cmd = nextToken(p);
+    if (!cmd)
+        return CMD_OK;
+
+    char *pre[COMMAND_MAX_ARGS];
+    uint8_t preCount = 0;
+    CommandArgs args;
+    memset(&args, 0, sizeof(args));
+    CommandStatus status = CMD_OK;
+    int8_t idx = resolve(cmd, p, pre, preCount);
+    if (idx < 0)
+        status = CMD_ERR_UNKNOWN;
+
+    uint16_t schema = idx >= 0 ? pgm_read_word(&COMMANDS[idx].schema) : 0;
+    for (uint8_t i = 0; status == CMD_OK && i < COMMAND_MAX_ARGS; ++i)
+    {
+        uint8_t type = argTypeAt(schema, i);
+        if (type == ARG_NONE)
+            break;
+        char *tok = i < preCount ? pre[i] : ((type & ~ARG_OPTIONAL) == ARG_DAYS ? restOfLine(p) : nextToken(p));
+        if (!tok)
+        {
+            if (!(type & ARG_OPTIONAL))
+                status = CMD_ERR_ARGS;
+            break;
+        }
+        status = parseArg(type, tok, args.v[i]);
+    }
+    if (status == CMD_OK && nextToken(p))
+        status = CMD_ERR_ARGS;
+    if (status == CMD_OK)
+        status = invoke(static_cast<uint8_t>(idx), ctx, args);
+#if DEBUG_MODE
+    DBG_S("[CMD] ");
+    DBG_V(cmd);
+    DBG_S(" -> ");
+    DBG_VL(status);
+#endif
+    reply(ctx.out, status);
+    return status;
+}
+
+void CommandRegistry::reply(Print &out, CommandStatus status)
+{
+    switch (status)
+    {
+    case CMD_OK:
+        out.println(F("OK"));
+        break;
+    case CMD_ERR_UNKNOWN:
+        out.println(F("ERR unknown"));
+        break;
+    case CMD_ERR_ARGS:
+        out.println(F("ERR args"));
+        break;
+    case CMD_ERR_VALUE:
+        out.println(F("ERR value"));
+        break;
+    case CMD_ERR_REPLICA:
+        out.println(F("ERR replica"));
+        break;
+    default:
+        out.println(F("ERR rejected"));
+        break;
+    }
+}
+
+void CommandRegistry::list(Print &out)
+{
+    static const char typeNames[] PROGMEM = "-\0id\0time\0days\0bool\0word\0sel";
+    for (uint8_t i = 0; i < COMMAND_COUNT; ++i)
+    {
+        char name[sizeof(CommandDef::name)];
+        memcpy_P(name, COMMANDS[i].name, sizeof(name));
+        uint16_t schema = pgm_read_word(&COMMANDS[i].schema);
+        // Printed in wire order: "upd dt" lists as "upd id dt days".
+        char *selector = strchr(name, ' ');
+        if (selector)
+            *selector++ = '\0';
+        out.print(name);
+        for (uint8_t a = 0; a < COMMAND_MAX_ARGS; ++a)
+        {
+            uint8_t type = argTypeAt(schema, a);
+            if (type == ARG_NONE)
+                break;
+            uint8_t base = type & ~ARG_OPTIONAL;
+            if (base == ARG_SELECT)
+            {
+                out.print(' ');
+                out.print(selector ? selector : "");
+                continue;
+            }
+            const char *t = typeNames;
+            for (uint8_t k = 0; k < base; ++k)
+                t += strlen_P(t) + 1;
+            char buf[6];
+            memcpy_P(buf, t, strlen_P(t) + 1);
+            out.print(' ');
+            if (type & ARG_OPTIONAL)
+                out.print('[');
+            out.print(buf);
+            if (type & ARG_OPTIONAL)
+                out.print(']');
+        }
+        out.println();
+    }
+    // The table is all the per-command cost outside the handler's own code.
+    out.print(F("cmds n="));
+    out.print(COMMAND_COUNT);
+    out.print(F(" flash="));
+    out.print(static_cast<unsigned>(COMMAND_COUNT * sizeof(CommandDef)));
+    out.print(F(" bytes_per_cmd="));
+    out.print(static_cast<unsigned>(sizeof(CommandDef)));
+    out.println(F(" ram=0"));
+}
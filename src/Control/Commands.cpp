@@ -0,0 +1,220 @@
+#include "Control/CommandRegistry.h"
+#include "Diag/MemProfiler.h"
+#include "Diag/TraceRecorder.h"
+#include "RFID/FdxbDriver.h"
+#include "RFID/ReaderHealth.h"
+#include "RFID/TagId.h"
+#include <avr/pgmspace.h>
+#include <string.h>
+
+static CommandStatus result(bool ok)
+{
+    return ok ? CMD_OK : CMD_ERR_REJECTED;
+}
+
+// boot: cold or warm start and how long the door took to be ready
+static CommandStatus cmdBoot(CommandContext &ctx, const CommandArgs &)
+{
+    ctx.out.print(F("warm="));
+    ctx.out.print(ctx.coordinator.wasWarmStart() ? 1 : 0);
+    ctx.out.print(F(" ready_us="));
+    ctx.out.println(ctx.coordinator.getReadyUs());
+    return CMD_OK;
+}
+
+// cmds
+static CommandStatus cmdList(CommandContext &ctx, const CommandArgs &)
+{
+    CommandRegistry::list(ctx.out);
+    return CMD_OK;
+}
+
+// d <id>
+static CommandStatus cmdDelete(CommandContext &ctx, const CommandArgs &a)
+{
+    return result(ctx.coordinator.deleteInterval(a.v[0].text));
+}
+
+// loc: where each tag was last seen going, and the door's in/out totals
+static CommandStatus cmdLocation(CommandContext &ctx, const CommandArgs &)
+{
+    const DirectionTracker &dt = ctx.coordinator.getDirection();
+    for (uint8_t i = 0; i < ctx.coordinator.getNumTags(); ++i)
+    {
+        ctx.out.print(i);
+        PetLocation loc = dt.getLocation(i);
+        if (loc == LOCATION_INSIDE)
+            ctx.out.println(F(" in"));
+        else if (loc == LOCATION_OUTSIDE)
+            ctx.out.println(F(" out"));
+        else
+            ctx.out.println(F(" ?"));
+    }
+    ctx.out.print(F("ins="));
+    ctx.out.print(dt.getInCount());
+    ctx.out.print(F(" outs="));
+    ctx.out.println(dt.getOutCount());
+    return CMD_OK;
+}
+
+// mem
+static CommandStatus cmdMem(CommandContext &ctx, const CommandArgs &)
+{
+    MemProfiler::report(ctx.out);
+    return CMD_OK;
+}
+
+// rdr
+static CommandStatus cmdReaders(CommandContext &ctx, const CommandArgs &)
+{
+    ReaderMonitor::report(ctx.out, millis());
+    return CMD_OK;
+}
+
+// reboot: write the tables out and reset; the door resumes warm
+static CommandStatus cmdReboot(CommandContext &ctx, const CommandArgs &)
+{
+    if (!ctx.shutdown)
+        return CMD_ERR_REJECTED;
+    ctx.out.println(F("rebooting"));
+    ctx.shutdown();
+    return CMD_OK;
+}
+
+// s <id> <start> <end> [days]
+static CommandStatus cmdSet(CommandContext &ctx, const CommandArgs &a)
+{
+    uint8_t days = a.v[3].present ? static_cast<uint8_t>(a.v[3].value) : 0x7F;
+    return result(ctx.coordinator.addInterval(a.v[0].text, a.v[1].value, a.v[2].value, days));
+}
+
+// A tag ID as the reader reports it, in hex ("E2004709...", 2 digits per
+// byte), or the 15-digit number from an FDX-B microchip certificate.
+static bool parseTagId(const char *t, uint8_t *id, uint8_t &len)
+{
+    if (FdxbDriver::fromCertificate(t, id))
+    {
+        len = FdxbDriver::ID_LEN;
+        return true;
+    }
+    size_t n = strlen(t);
+    if (n == 0 || (n & 1) || n / 2 > MAX_TAG_ID_LEN)
+        return false;
+    for (len = 0; len < n / 2; ++len)
+    {
+        int8_t hi = hexNibble(t[2 * len]);
+        int8_t lo = hexNibble(t[2 * len + 1]);
+        if (hi < 0 || lo < 0)
+            return false;
+        id[len] = static_cast<uint8_t>((hi << 4) | lo);
+    }
+    return true;
+}
+
+// tag add <id>
+static CommandStatus cmdTagAdd(CommandContext &ctx, const CommandArgs &a)
+{
+    uint8_t id[MAX_TAG_ID_LEN];
+    uint8_t len;
+    if (!parseTagId(a.v[1].text, id, len))
+        return CMD_ERR_VALUE;
+    return result(ctx.coordinator.addTag(id, len));
+}
+
+// tag del <id>
+static CommandStatus cmdTagDelete(CommandContext &ctx, const CommandArgs &a)
+{
+    uint8_t id[MAX_TAG_ID_LEN];
+    uint8_t len;
+    if (!parseTagId(a.v[1].text, id, len))
+        return CMD_ERR_VALUE;
+    return result(ctx.coordinator.removeTag(id, len));
+}
+
+// tag ls: one "<index> <hex id>" line per enrolled tag
+static CommandStatus cmdTagList(CommandContext &ctx, const CommandArgs &)
+{
+    for (uint8_t i = 0; i < ctx.coordinator.getNumTags(); ++i)
+    {
+        uint8_t len;
+        const uint8_t *id = ctx.coordinator.getTag(i, len);
+        ctx.out.print(i);
+        ctx.out.print(' ');
+        printHexBytes(ctx.out, id, len);
+        ctx.out.println();
+    }
+    return CMD_OK;
+}
+
+// trace [on|off|clear]
+static CommandStatus cmdTrace(CommandContext &ctx, const CommandArgs &a)
+{
+    if (!a.v[0].present)
+        TraceRecorder::dump(ctx.out, ctx.coordinator);
+    else if (strcasecmp(a.v[0].text, "on") == 0)
+        TraceRecorder::setCapturing(true);
+    else if (strcasecmp(a.v[0].text, "off") == 0)
+        TraceRecorder::setCapturing(false);
+    else if (strcasecmp(a.v[0].text, "clear") == 0)
+        TraceRecorder::clear();
+    else
+        return CMD_ERR_VALUE;
+    return CMD_OK;
+}
+
+// upd <id> dt <days>
+static CommandStatus cmdUpdateDays(CommandContext &ctx, const CommandArgs &a)
+{
+    return result(ctx.coordinator.setIntervalDays(a.v[0].text, static_cast<uint8_t>(a.v[2].value)));
+}
+
+// upd <id> st <bool>
+static CommandStatus cmdUpdateStatus(CommandContext &ctx, const CommandArgs &a)
+{
+    return result(ctx.coordinator.setIntervalEnabled(a.v[0].text, a.v[2].value != 0));
+}
+
+// upd <id> t1 <start>
+static CommandStatus cmdUpdateStart(CommandContext &ctx, const CommandArgs &a)
+{
+    return result(ctx.coordinator.setIntervalStart(a.v[0].text, a.v[2].value));
+}
+
+// upd <id> t2 <end>
+static CommandStatus cmdUpdateEnd(CommandContext &ctx, const CommandArgs &a)
+{
+    return result(ctx.coordinator.setIntervalEnd(a.v[0].text, a.v[2].value));
+}
+
+// Keep sorted by name: lookup is a binary search (enforced below).
+constexpr CommandDef COMMANDS[] PROGMEM = {
+    {"boot", argSchema(), 0, cmdBoot},
+    {"cmds", argSchema(), 0, cmdList},
+    {"d", argSchema(ARG_ID), CMD_EDITS_TABLES, cmdDelete},
+    {"loc", argSchema(), 0, cmdLocation},
+    {"mem", argSchema(), 0, cmdMem},
+    {"rdr", argSchema(), 0, cmdReaders},
+    {"reboot", argSchema(), 0, cmdReboot},
+    {"s", argSchema(ARG_ID, ARG_TIME, ARG_TIME, ARG_DAYS | ARG_OPTIONAL), CMD_EDITS_TABLES, cmdSet},
+    {"tag add", argSchema(ARG_SELECT, ARG_WORD), CMD_EDITS_TABLES, cmdTagAdd},
+    {"tag del", argSchema(ARG_SELECT, ARG_WORD), CMD_EDITS_TABLES, cmdTagDelete},
+    {"tag ls", argSchema(ARG_SELECT), 0, cmdTagList},
+    {"trace", argSchema(ARG_WORD | ARG_OPTIONAL), 0, cmdTrace},
+    {"upd dt", argSchema(ARG_ID, ARG_SELECT, ARG_DAYS), CMD_EDITS_TABLES, cmdUpdateDays},
+    {"upd st", argSchema(ARG_ID, ARG_SELECT, ARG_BOOL), CMD_EDITS_TABLES, cmdUpdateStatus},
+    {"upd t1", argSchema(ARG_ID, ARG_SELECT, ARG_TIME), CMD_EDITS_TABLES, cmdUpdateStart},
+    {"upd t2", argSchema(ARG_ID, ARG_SELECT, ARG_TIME), CMD_EDITS_TABLES, cmdUpdateEnd},
+};
+constexpr uint8_t COMMAND_COUNT = sizeof(COMMANDS) / sizeof(COMMANDS[0]);
+
+constexpr int nameCompare(const char *a, const char *b)
+{
+    return (*a != *b || *a == '\0') ? (*a - *b) : nameCompare(a + 1, b + 1);
+}
+
+constexpr bool sortedFrom(uint8_t i)
+{
+    return i + 1 >= COMMAND_COUNT || (nameCompare(COMMANDS[i].name, COMMANDS[i + 1].name) < 0 && sortedFrom(i + 1));
+}
+
+static_assert(sortedFrom(0), "COMMANDS must be sorted by name, lower case");
@@ -0,0 +1,64 @@
+#include "Core/DirectionTracker.h"
+#include <string.h>
+
+static PetLocation locationOf(ReaderSide side)
+{
+    if (side == READER_INSIDE)
+        return LOCATION_INSIDE;
+    if (side == READER_OUTSIDE)
+        return LOCATION_OUTSIDE;
+    return LOCATION_UNKNOWN;
+}
+
+void DirectionTracker::reset()
+{
+    memset(tracks, 0, sizeof(tracks));
+    ins = 0;
+    outs = 0;
+}
+
+void DirectionTracker::clear(uint8_t idx)
+{
+    if (idx < MAX_TAGS)
+        memset(&tracks[idx], 0, sizeof(tracks[idx]));
+}
+
+void DirectionTracker::remove(uint8_t idx, uint8_t count)
+{
+    if (idx >= count || count > MAX_TAGS)
+        return;
+    memmove(&tracks[idx], &tracks[idx + 1], (count - idx - 1) * sizeof(Track));
+    clear(count - 1);
+}
+
+void DirectionTracker::onSighting(uint8_t idx, ReaderSide side, bool passageStart)
+{
+    if (idx >= MAX_TAGS || side == READER_SINGLE)
+        return;
+    Track &t = tracks[idx];
+    if (passageStart || t.first == READER_SINGLE)
+        t.first = side;
+    t.last = side;
+}
+
+PassageDirection DirectionTracker::endPassage(uint8_t idx)
+{
+    if (idx >= MAX_TAGS)
+        return PASSAGE_NONE;
+    Track &t = tracks[idx];
+    PassageDirection dir = PASSAGE_NONE;
+    if (t.first != READER_SINGLE && t.last != t.first)
+    {
+        dir = (t.last == READER_INSIDE) ? PASSAGE_IN : PASSAGE_OUT;
+        if (dir == PASSAGE_IN)
+            ++ins;
+        else
+            ++outs;
+    }
+    // Seen on one side only: the pet is (still) there, whatever we believed.
+    if (t.last != READER_SINGLE)
+        t.location = locationOf(t.last);
+    t.first = READER_SINGLE;
+    t.last = READER_SINGLE;
+    return dir;
+}
@@ -1,86 +1,283 @@
 #include "Core/SystemCoordinator.h"
 #include <string.h>
-#include <avr/pgmspace.h>
-#include <Servo.h>
 
-static Servo doorServo;
+static_assert(__has_trivial_constructor(SystemCoordinator),
+              "SystemCoordinator must not have initializers; it is placed in .noinit");
 
-void SystemCoordinator::begin()
+// FNV-1a, evaluated at compile time (single expression for C++11).
+static constexpr uint32_t fnv1a(const char *s, uint32_t h = 2166136261UL)
 {
+    return *s ? fnv1a(s + 1, (h ^ static_cast<uint8_t>(*s)) * 16777619UL) : h;
+}
+
+// Changes whenever the object layout or the build stamp does, so a reflashed
+// image never resumes another build's state even if the layout happens to
+// match (BUILD_ID, see Config.h).
+static_assert(sizeof(BUILD_ID) > 1, "BUILD_ID must not be empty");
+static constexpr uint32_t WARM_MAGIC = 0x50415753UL ^ sizeof(SystemCoordinator) ^ fnv1a(BUILD_ID);
+
+void SystemCoordinator::begin(bool allowWarm)
+{
+    if (allowWarm && isWarmStateValid())
+    {
+        resumeWarm();
+        return;
+    }
+
+    warmMagic = WARM_MAGIC;
+    warmStart = false;
+    replica = false;
+    changeHook = nullptr;
+    changeCtx = nullptr;
+    passageHook = nullptr;
+    passageCtx = nullptr;
+    clockBaseMs = 0;
+    savedClockMs = 0;
+    dayStartMs = 0;
+    dayNumber = 0;
     intervalCount = 0;
     numTags = 0;
     memset(tagPresent, 0, sizeof(tagPresent));
+    memset(transit, 0, sizeof(transit));
+    direction.reset();
     for (uint8_t i = 0; i < MAX_TAGS; ++i)
         lastSeen[i] = 0;
+    ++tagTableVersion;
     rfidEnabled = false;
     doorOpen = false;
-    lastCheckMs = millis();
-    doorServo.attach(SERVO_PIN);
-    doorServo.writeMicroseconds(500);
-    doorOpen = false;
+    lastCheckMs = clockMs();
+    door.begin(SERVO_PIN, clockMs());
 
 #if DEBUG_MODE
     DBG_SL("[SYS] init");
 #endif
-    uint8_t toLoad = DEFAULT_TAGS_COUNT;
-    if (toLoad > MAX_TAGS)
-        toLoad = MAX_TAGS;
-    for (uint8_t i = 0; i < toLoad; ++i)
+    evaluateNow(true);
+    readyUs = micros();
+    seal();
+}
+
+uint16_t SystemCoordinator::computeChecksum() const
+{
+    // BSD rotate-and-add over every member after warmChecksum: cheap enough
+    // to run every loop and order-sensitive, unlike a plain sum.
+    const uint8_t *p = reinterpret_cast<const uint8_t *>(this) + sizeof(warmChecksum);
+    const uint8_t *end = reinterpret_cast<const uint8_t *>(this) + sizeof(*this);
+    uint16_t sum = 0x5AA5;
+    while (p < end)
     {
-        uint8_t buf[12];
-        memcpy_P(buf, &DEFAULT_TAGS[i], 12);
-        addTag(buf, 12);
+        sum = static_cast<uint16_t>((sum >> 1) | (sum << 15));
+        sum = static_cast<uint16_t>(sum + *p++);
     }
+    return sum;
+}
 
-    evaluateNow(true);
+bool SystemCoordinator::isWarmStateValid() const
+{
+    if (warmMagic != WARM_MAGIC)
+        return false;
+    if (intervalCount > MAX_INTERVALS || numTags > MAX_TAGS)
+        return false;
+    return computeChecksum() == warmChecksum;
+}
+
+void SystemCoordinator::seal()
+{
+    savedClockMs = clockMs();
+    warmChecksum = computeChecksum();
+}
+
+void SystemCoordinator::resumeWarm()
+{
+    // Continue the schedule clock from the last sealed value; the few seconds
+    // spent in the WDT timeout and reset are lost, which only delays timeouts.
+    clockBaseMs = savedClockMs - millis();
+    warmStart = true;
+    // Hook owners register again in their begin(); never call through a
+    // pointer or context saved before the reset.
+    changeHook = nullptr;
+    changeCtx = nullptr;
+    passageHook = nullptr;
+    passageCtx = nullptr;
+    door.resume(SERVO_PIN, clockMs());
+#if DEBUG_MODE
+    DBG_S("[SYS] warm resume door=");
+    DBG_V(doorOpen ? 1 : 0);
+    DBG_S(" tags=");
+    DBG_V(numTags);
+    DBG_S(" iv=");
+    DBG_VL(intervalCount);
+#endif
+    readyUs = micros();
+    seal();
 }
 
 int8_t SystemCoordinator::findTagIndex(const uint8_t *epc, uint8_t len) const
 {
-    if (!epc || len != 12)
+    if (!epc || len == 0 || len > MAX_TAG_ID_LEN)
         return -1;
     for (uint8_t i = 0; i < numTags; ++i)
     {
-        if (memcmp(tags[i], epc, 12) == 0)
+        if (tagLen[i] == len && memcmp(tags[i], epc, len) == 0)
             return i;
     }
     return -1;
 }
 
+void SystemCoordinator::setChangeHook(CoordinatorChangeHook hook, void *ctx)
+{
+    changeHook = hook;
+    changeCtx = ctx;
+}
+
+void SystemCoordinator::setPassageHook(PassageHook hook, void *ctx)
+{
+    passageHook = hook;
+    passageCtx = ctx;
+}
+
+void SystemCoordinator::notifyChange(CoordinatorChange kind, const void *key, uint8_t keyLen)
+{
+    if (changeHook)
+        changeHook(changeCtx, kind, static_cast<const uint8_t *>(key), keyLen);
+}
+
+// Change hook key of an interval: its id without the terminator, the same
+// for set and delete notifications.
+static uint8_t intervalKeyLen(const char *id)
+{
+    return static_cast<uint8_t>(strnlen(id, sizeof(IntervalRecord::id) - 1));
+}
+
+void SystemCoordinator::notifyInterval(uint8_t idx)
+{
+    const char *id = intervals[idx].id;
+    notifyChange(CHANGE_INTERVAL_SET, id, intervalKeyLen(id));
+}
+
+const uint8_t *SystemCoordinator::getTag(uint8_t idx, uint8_t &len) const
+{
+    if (idx >= numTags)
+    {
+        len = 0;
+        return nullptr;
+    }
+    len = tagLen[idx];
+    return tags[idx];
+}
+
 bool SystemCoordinator::isValidTag(const uint8_t *epc, uint8_t len) const
 {
     return findTagIndex(epc, len) >= 0;
 }
 
-bool SystemCoordinator::addTag(const uint8_t *epc, uint8_t len)
+bool SystemCoordinator::addTag(const uint8_t *id, uint8_t len)
 {
-    if (!epc || len != 12)
+    if (!id || len == 0 || len > MAX_TAG_ID_LEN)
         return false;
-    if (numTags >= MAX_TAGS)
+    if (numTags >= MAX_TAGS || findTagIndex(id, len) >= 0)
         return false;
-    memcpy(tags[numTags], epc, 12);
+    memcpy(tags[numTags], id, len);
+    tagLen[numTags] = len;
     tagPresent[numTags] = false;
     lastSeen[numTags] = 0;
+    memset(&transit[numTags], 0, sizeof(transit[numTags]));
+    direction.clear(numTags);
     ++numTags;
+    ++tagTableVersion;
 #if DEBUG_MODE
     DBG_S("[SYS] tag added idx=");
     DBG_VL(numTags - 1);
 #endif
+    notifyChange(CHANGE_TAG_ADDED, id, len);
+    return true;
+}
+
+bool SystemCoordinator::removeTag(const uint8_t *id, uint8_t len)
+{
+    int8_t idx = findTagIndex(id, len);
+    if (idx < 0)
+        return false;
+    for (uint8_t j = idx; j + 1 < numTags; ++j)
+    {
+        memcpy(tags[j], tags[j + 1], MAX_TAG_ID_LEN);
+        tagLen[j] = tagLen[j + 1];
+        tagPresent[j] = tagPresent[j + 1];
+        lastSeen[j] = lastSeen[j + 1];
+        transit[j] = transit[j + 1];
+    }
+    direction.remove(idx, numTags);
+    --numTags;
+    ++tagTableVersion;
+#if DEBUG_MODE
+    DBG_S("[SYS] tag removed idx=");
+    DBG_VL(idx);
+#endif
+    notifyChange(CHANGE_TAG_REMOVED, id, len);
     return true;
 }
 
+void SystemCoordinator::clearTags()
+{
+    // Bulk reset before a full table arrives (bus replicas, TableStore::load());
+    // not notified.
+    numTags = 0;
+    memset(tagPresent, 0, sizeof(tagPresent));
+    memset(transit, 0, sizeof(transit));
+    direction.reset();
+    ++tagTableVersion;
+}
+
 void SystemCoordinator::onTagDetected(const uint8_t *epc, uint8_t len)
 {
-    if (!epc || len != 12)
-        return;
     int8_t idx = findTagIndex(epc, len);
     if (idx < 0)
         return;
+    TagSighting s;
+    s.reads = 1;
+    s.rssi = INT8_MIN;
+    s.ageMs = 0;
+    s.gapMs = 0;
+    s.side = READER_SINGLE;
+    onTagSighting(idx, s);
+}
+
+void SystemCoordinator::onTagSighting(uint8_t idx, const TagSighting &s)
+{
+    if (idx >= numTags)
+        return;
+    uint32_t now = clockMs() - s.ageMs;
+    TagTransit &t = transit[idx];
+    if (tagPresent[idx])
+    {
+        // Aggregated sightings are throttled to the cache window; the front
+        // end measures the gaps between the raw reads behind them.
+        recordGap(idx, s.gapMs ? s.gapMs : now - lastSeen[idx]);
+    }
+    else
+    {
+        // Seen again shortly after timing out: the door most likely closed
+        // on the pet, so that gap belongs to the previous passage too.
+        if (t.passages && now - lastSeen[idx] < DOOR_DELAY_MAX_MS)
+            recordGap(idx, now - lastSeen[idx]);
+        t.firstSeen = now;
+        t.reads = 0;
+    }
+    direction.onSighting(idx, s.side, !tagPresent[idx]);
+    if (t.reads < UINT16_MAX - s.reads)
+        t.reads += s.reads;
     tagPresent[idx] = true;
-    lastSeen[idx] = millis();
+    lastSeen[idx] = now;
 #if DEBUG_MODE
     DBG_S("[SYS] seen idx=");
-    DBG_VL(idx);
+    DBG_V(idx);
+    DBG_S(" n=");
+    DBG_V(s.reads);
+    DBG_S(" rssi=");
+    DBG_V(s.rssi);
+    DBG_S(" age=");
+    DBG_V(s.ageMs);
+    DBG_S(" side=");
+    DBG_VL(s.side);
 #endif
     if (!doorOpen)
         openDoor();
@@ -90,7 +287,7 @@ void SystemCoordinator::openDoor()
 {
     if (doorOpen)
         return;
-    doorServo.writeMicroseconds(2500);
+    door.open(clockMs());
     doorOpen = true;
 #if DEBUG_MODE
     DBG_SL("[SYS] open");
@@ -101,27 +298,112 @@ void SystemCoordinator::closeDoor()
 {
     if (!doorOpen)
         return;
-    doorServo.writeMicroseconds(500);
+    door.close(clockMs());
     doorOpen = false;
 #if DEBUG_MODE
     DBG_SL("[SYS] close");
 #endif
 }
 
+// EWMA step with gain 1/2^shift, in integer ms.
+static uint16_t ewma(uint16_t mean, uint16_t sample, uint8_t shift)
+{
+    int32_t m = mean + ((static_cast<int32_t>(sample) - mean) >> shift);
+    return static_cast<uint16_t>(m < 0 ? 0 : m);
+}
+
+void SystemCoordinator::recordGap(uint8_t idx, uint32_t gapMs)
+{
+    TagTransit &t = transit[idx];
+    uint16_t gap = gapMs > DOOR_DELAY_MAX_MS ? DOOR_DELAY_MAX_MS : static_cast<uint16_t>(gapMs);
+    if (t.gapMean == 0)
+    {
+        t.gapMean = gap;
+        t.gapDev = gap / 2;
+        return;
+    }
+    uint16_t err = gap > t.gapMean ? gap - t.gapMean : t.gapMean - gap;
+    t.gapDev = ewma(t.gapDev, err, 2);
+    t.gapMean = ewma(t.gapMean, gap, 3);
+}
+
+void SystemCoordinator::endPassage(uint8_t idx)
+{
+    TagTransit &t = transit[idx];
+    uint32_t span = lastSeen[idx] - t.firstSeen;
+    uint16_t ms = span > UINT16_MAX ? UINT16_MAX : static_cast<uint16_t>(span);
+    if (t.passages == 0)
+    {
+        t.transitMean = ms;
+        t.readsMean = t.reads;
+    }
+    else
+    {
+        t.transitMean = ewma(t.transitMean, ms, 3);
+        t.readsMean = ewma(t.readsMean, t.reads, 3);
+    }
+    if (t.passages < UINT16_MAX)
+        ++t.passages;
+}
+
+void SystemCoordinator::setTransit(uint8_t idx, const TagTransit &t)
+{
+    if (idx >= numTags)
+        return;
+    TagTransit &d = transit[idx];
+    d.gapMean = t.gapMean;
+    d.gapDev = t.gapDev;
+    d.transitMean = t.transitMean;
+    d.readsMean = t.readsMean;
+    d.passages = t.passages;
+}
+
+uint16_t SystemCoordinator::getCloseDelayMs(uint8_t idx) const
+{
+    if (idx >= numTags)
+        return DOOR_DELAY_MS;
+    const TagTransit &t = transit[idx];
+    if (t.passages < DOOR_LEARN_PASSAGES || t.gapMean == 0)
+        return DOOR_DELAY_MS;
+    // Cover the tag's usual read gaps with margin, then give pets that take
+    // longer to pass a proportionally longer clearance after the last read.
+    uint32_t d = static_cast<uint32_t>(t.gapMean) + 4UL * t.gapDev + t.transitMean / 4;
+    if (d < DOOR_DELAY_MIN_MS)
+        d = DOOR_DELAY_MIN_MS;
+    if (d > DOOR_DELAY_MAX_MS)
+        d = DOOR_DELAY_MAX_MS;
+    return static_cast<uint16_t>(d);
+}
+
 void SystemCoordinator::checkTagTimeouts()
 {
     bool anyPresent = false;
-    unsigned long now = millis();
+    uint32_t now = clockMs();
     for (uint8_t i = 0; i < numTags; ++i)
     {
         if (tagPresent[i])
         {
-            if ((now - lastSeen[i]) > DOOR_DELAY_MS)
+            if ((now - lastSeen[i]) > getCloseDelayMs(i))
             {
                 tagPresent[i] = false;
+                endPassage(i);
+                PassageDirection dir = direction.endPassage(i);
+                if (dir != PASSAGE_NONE && passageHook)
+                    passageHook(passageCtx, i, dir);
 #if DEBUG_MODE
+                if (dir != PASSAGE_NONE)
+                {
+                    DBG_S("[SYS] passage idx=");
+                    DBG_V(i);
+                    if (dir == PASSAGE_IN)
+                        DBG_SL(" in");
+                    else
+                        DBG_SL(" out");
+                }
                 DBG_S("[SYS] t/o idx=");
-                DBG_VL(i);
+                DBG_V(i);
+                DBG_S(" after=");
+                DBG_VL(getCloseDelayMs(i));
 #endif
             }
             else
@@ -170,6 +452,7 @@ bool SystemCoordinator::addInterval(const char *id, uint16_t startMin, uint16_t
     rec.endMin = endMin;
     rec.daysMask = daysMask;
     rec.enabled = true;
+    notifyInterval(intervalCount - 1);
 #if DEBUG_MODE
     DBG_S("[SYS] add id=");
     DBG_V(id);
@@ -194,6 +477,7 @@ bool SystemCoordinator::updateIntervalTime(const char *id, uint16_t startMin, ui
     intervals[idx].startMin = startMin;
     intervals[idx].endMin = endMin;
     intervals[idx].daysMask = daysMask;
+    notifyInterval(idx);
 #if DEBUG_MODE
     DBG_S("[SYS] upd id=");
     DBG_V(id);
@@ -226,11 +510,44 @@ bool SystemCoordinator::deleteInterval(const char *id)
     DBG_S("[SYS] del id=");
     DBG_VL(id);
 #endif
+    notifyChange(CHANGE_INTERVAL_DELETED, id, intervalKeyLen(id));
 
     evaluateNow(true);
     return true;
 }
 
+bool SystemCoordinator::putInterval(const IntervalRecord &rec)
+{
+    // Insert-or-replace of a whole record, as received from a replica source.
+    char id[sizeof(rec.id)];
+    strncpy(id, rec.id, sizeof(id) - 1);
+    id[sizeof(id) - 1] = '\0';
+    int8_t idx = findIndexById(id);
+    if (idx < 0)
+    {
+        if (intervalCount >= MAX_INTERVALS)
+            return false;
+        idx = intervalCount++;
+    }
+    intervals[idx] = rec;
+    memcpy(intervals[idx].id, id, sizeof(id));
+    notifyInterval(idx);
+    evaluateNow(true);
+    return true;
+}
+
+void SystemCoordinator::clearIntervals()
+{
+    intervalCount = 0;
+    evaluateNow(true);
+}
+
+const IntervalRecord *SystemCoordinator::findInterval(const char *id) const
+{
+    int8_t idx = findIndexById(id);
+    return idx < 0 ? nullptr : &intervals[idx];
+}
+
 bool SystemCoordinator::setIntervalStatus(const char *id, bool enabled)
 {
     int8_t idx = findIndexById(id);
@@ -243,6 +560,7 @@ bool SystemCoordinator::setIntervalStatus(const char *id, bool enabled)
         return false;
     }
     intervals[idx].enabled = enabled;
+    notifyInterval(idx);
 #if DEBUG_MODE
     DBG_S("[SYS] setStatus id=");
     DBG_V(id);
@@ -272,6 +590,7 @@ bool SystemCoordinator::setIntervalStart(const char *id, uint16_t startMin)
         return false;
     }
     intervals[idx].startMin = startMin;
+    notifyInterval(idx);
 #if DEBUG_MODE
     DBG_S("[SYS] setStart id=");
     DBG_V(id);
@@ -295,6 +614,7 @@ bool SystemCoordinator::setIntervalEnd(const char *id, uint16_t endMin)
         return false;
     }
     intervals[idx].endMin = endMin;
+    notifyInterval(idx);
 #if DEBUG_MODE
     DBG_S("[SYS] setEnd id=");
     DBG_V(id);
@@ -318,6 +638,7 @@ bool SystemCoordinator::setIntervalDays(const char *id, uint8_t daysMask)
         return false;
     }
     intervals[idx].daysMask = daysMask;
+    notifyInterval(idx);
 #if DEBUG_MODE
     DBG_S("[SYS] setDays id=");
     DBG_V(id);
@@ -417,24 +738,35 @@ void SystemCoordinator::evaluateNow(bool forced)
 
 void SystemCoordinator::loop()
 {
-    unsigned long now = millis();
+    uint32_t now = clockMs();
+    // Count whole days by difference so the 32-bit clock wrapping every 49.7
+    // days does not move the schedule.
+    while (now - dayStartMs >= 86400000UL)
+    {
+        dayStartMs += 86400000UL;
+        ++dayNumber;
+    }
     if ((now - lastCheckMs) >= COORDINATOR_CHECK_INTERVAL_MS)
     {
         lastCheckMs = now;
         evaluateNow(false);
     }
     checkTagTimeouts();
+    door.update(clockMs());
+    // Every mutation since the last loop (BT commands, tag reads) is covered
+    // here. The checksum walks the whole object at ~13 cycles per byte: about
+    // 0.5 ms for the ~600 B AVR layout, i.e. 5% of a 10 ms loop at 16 MHz.
+    seal();
 }
 
 uint16_t SystemCoordinator::getCurrentMinutes() const
 {
-    unsigned long totalMinutes = (millis() / 60000UL);
-    return static_cast<uint16_t>(totalMinutes % (24UL * 60UL));
+    uint32_t minutes = (clockMs() - dayStartMs) / 60000UL;
+    return static_cast<uint16_t>(minutes % (24UL * 60UL));
 }
 
 uint8_t SystemCoordinator::getTodayMaskBit() const
 {
-    unsigned long daysSinceBoot = (millis() / 86400000UL);
-    uint8_t dow = static_cast<uint8_t>(daysSinceBoot % 7UL);
+    uint8_t dow = static_cast<uint8_t>(dayNumber % 7U);
     return static_cast<uint8_t>(1u << dow);
 }
\ No newline at end of file
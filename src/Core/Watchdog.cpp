@@ -0,0 +1,106 @@
+#include "Core/Watchdog.h"
+#include "Core/Config.h"
+#include <avr/io.h>
+#include <avr/wdt.h>
+#include <avr/interrupt.h>
+
+// Survive the reset: written before .data/.bss init and by the WDT ISR.
+static uint8_t bootResetFlags __attribute__((section(".noinit")));
+static uint8_t bootStalledMask __attribute__((section(".noinit")));
+static uint8_t stalledMaskNext __attribute__((section(".noinit")));
+
+// First expiry only records stalled tasks, so a hang resets after 2 x 2 s.
+static constexpr uint8_t WDT_TIMEOUT = WDTO_2S;
+
+static volatile uint8_t expectedMask = 0;
+static volatile uint8_t pendingMask = 0;
+
+static constexpr uint8_t RESET_FLAG_BITS = _BV(WDRF) | _BV(BORF) | _BV(EXTRF) | _BV(PORF);
+
+// Runs before the C runtime init. After a WDT reset WDRF keeps the watchdog
+// armed at its shortest timeout, so it must be cleared here or the board
+// loops in resets.
+//
+// The reset cause is only known without a bootloader (ISP upload) or with
+// Optiboot 6 or later, which clears MCUSR but hands its value over in r2.
+// The stock Uno bootloader (Optiboot 4.4) clears MCUSR and leaves r2 holding
+// whatever it last used, so r2 is only taken when it looks like a flag set;
+// otherwise the flags read 0 (unknown) and SystemCoordinator::begin() has
+// only its magic and checksum to tell a warm start from random SRAM.
+void captureResetFlags() __attribute__((naked, used, section(".init3")));
+void captureResetFlags()
+{
+    uint8_t flags = MCUSR;
+    if (flags == 0)
+    {
+        uint8_t handedOver;
+        __asm__ __volatile__("mov %0, r2" : "=r"(handedOver));
+        if ((handedOver & ~RESET_FLAG_BITS) == 0)
+            flags = handedOver;
+    }
+    bootResetFlags = flags;
+    MCUSR = 0;
+    wdt_disable();
+}
+
+ISR(WDT_vect)
+{
+    // First expiry: note who is late. WDIE is now cleared by hardware, so the
+    // next expiry resets unless every task checks in and re-arms it.
+    stalledMaskNext = pendingMask;
+}
+
+void Watchdog::begin(uint8_t taskMask)
+{
+    bootStalledMask = (bootResetFlags & _BV(WDRF)) ? stalledMaskNext : 0;
+    stalledMaskNext = 0;
+    expectedMask = taskMask;
+    pendingMask = taskMask;
+    wdt_enable(WDT_TIMEOUT);
+    WDTCSR |= _BV(WDIE);
+#if DEBUG_MODE
+    DBG_S("[WDT] on rst=0x");
+    DBG_HEX(bootResetFlags);
+    DBG_S(" stalled=0x");
+    DBG_HEXL(bootStalledMask);
+#endif
+}
+
+void Watchdog::kick(uint8_t task)
+{
+    pendingMask &= static_cast<uint8_t>(~task);
+    if (pendingMask != 0)
+        return;
+    pendingMask = expectedMask;
+    wdt_reset();
+    WDTCSR |= _BV(WDIE);
+}
+
+void Watchdog::reboot()
+{
+    // Reset mode only (wdt_enable clears WDIE): no first-expiry interrupt.
+    wdt_enable(WDTO_15MS);
+    for (;;)
+    {
+    }
+}
+
+uint8_t Watchdog::resetFlags() const
+{
+    return bootResetFlags;
+}
+
+bool Watchdog::wasWatchdogReset() const
+{
+    return (bootResetFlags & _BV(WDRF)) != 0;
+}
+
+bool Watchdog::wasPowerOnReset() const
+{
+    return (bootResetFlags & (_BV(PORF) | _BV(BORF))) != 0;
+}
+
+uint8_t Watchdog::stalledTasks() const
+{
+    return bootStalledMask;
+}
\ No newline at end of file
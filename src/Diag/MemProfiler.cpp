@@ -0,0 +1,157 @@
+#include "Diag/MemProfiler.h"
+#include <avr/pgmspace.h>
+
+static constexpr uint8_t STACK_CANARY = 0xC5;
+static const MemFootprint *footprints = nullptr;
+static uint8_t footprintCount = 0;
+
+#if defined(__AVR__)
+extern uint8_t _end;
+extern uint8_t __stack;
+extern uint8_t __heap_start;
+extern uint8_t *__brkval;
+extern uint8_t __data_start;
+extern uint8_t __data_end;
+extern uint8_t __bss_start;
+extern uint8_t __bss_end;
+extern uint8_t __noinit_start;
+extern uint8_t __noinit_end;
+
+// Runs before .data/.bss init with SP at RAMEND and nothing on the stack yet.
+// Everything above _end (heap and stack) gets the canary; .noinit is below.
+void paintStack() __attribute__((naked, used, section(".init3")));
+void paintStack()
+{
+    uint8_t *p = &_end;
+    while (p <= &__stack)
+        *p++ = STACK_CANARY;
+}
+
+// Current top of the heap: malloc() moves it up over painted bytes.
+static uint8_t *heapEnd()
+{
+    return __brkval ? __brkval : &__heap_start;
+}
+
+static uint8_t *stackTop()
+{
+    return &__stack + 1;
+}
+
+static uint8_t *stackLimit()
+{
+    return reinterpret_cast<uint8_t *>(SP);
+}
+
+static uint16_t gapBytes()
+{
+    return static_cast<uint16_t>(&__stack - &_end + 1);
+}
+#else
+// Host: paint a window below the simulator's stack pointer once at begin().
+// Kept under 64 KB so the counters stay in the firmware's uint16_t range.
+static constexpr size_t HOST_WINDOW = 32 * 1024;
+static uintptr_t windowLow = 0;
+
+__attribute__((noinline)) static void paintHostStack()
+{
+    volatile uint8_t window[HOST_WINDOW];
+    for (size_t i = 0; i < HOST_WINDOW; ++i)
+        window[i] = STACK_CANARY;
+    windowLow = reinterpret_cast<uintptr_t>(&window[0]);
+}
+
+static uint8_t *heapEnd()
+{
+    return reinterpret_cast<uint8_t *>(windowLow);
+}
+
+static uint8_t *stackTop()
+{
+    return reinterpret_cast<uint8_t *>(windowLow + HOST_WINDOW);
+}
+
+static uint8_t *stackLimit()
+{
+    return static_cast<uint8_t *>(__builtin_frame_address(0));
+}
+#endif
+
+void MemProfiler::begin(const MemFootprint *table, uint8_t count)
+{
+    footprints = table;
+    footprintCount = count;
+#if !defined(__AVR__)
+    paintHostStack();
+#endif
+}
+
+uint16_t MemProfiler::freeNow()
+{
+    uint8_t *low = heapEnd();
+    uint8_t *sp = stackLimit();
+    if (!low || sp <= low)
+        return 0;
+    size_t n = static_cast<size_t>(sp - low);
+    return static_cast<uint16_t>(n > 0xFFFF ? 0xFFFF : n);
+}
+
+// Lowest byte the stack has written: the first one above the heap that lost
+// its canary. Starting at the heap end keeps heap blocks out of the count.
+static const uint8_t *deepestStack()
+{
+    const uint8_t *p = heapEnd();
+    const uint8_t *sp = stackLimit();
+    while (p < sp && *p == STACK_CANARY)
+        ++p;
+    return p;
+}
+
+uint16_t MemProfiler::neverUsed()
+{
+    if (!heapEnd())
+        return 0;
+    size_t n = static_cast<size_t>(deepestStack() - heapEnd());
+    return static_cast<uint16_t>(n > 0xFFFF ? 0xFFFF : n);
+}
+
+uint16_t MemProfiler::stackPeak()
+{
+    if (!heapEnd())
+        return 0;
+    const uint8_t *deepest = deepestStack();
+    uint8_t *top = stackTop();
+    return deepest < top ? static_cast<uint16_t>(top - deepest) : 0;
+}
+
+void MemProfiler::report(Print &out)
+{
+#if defined(__AVR__)
+    out.print(F("mem data="));
+    out.print(static_cast<unsigned>(&__data_end - &__data_start));
+    out.print(F(" bss="));
+    out.print(static_cast<unsigned>(&__bss_end - &__bss_start));
+    out.print(F(" noinit="));
+    out.print(static_cast<unsigned>(&__noinit_end - &__noinit_start));
+    out.print(F(" gap="));
+    out.println(gapBytes());
+#else
+    out.println(F("mem host build: sizes below are x86-64, not AVR"));
+#endif
+    out.print(F("stack peak="));
+    out.print(stackPeak());
+    out.print(F(" free_now="));
+    out.print(freeNow());
+    out.print(F(" never_used="));
+    out.println(neverUsed());
+    for (uint8_t i = 0; i < footprintCount; ++i)
+    {
+        MemFootprint row;
+        memcpy_P(&row, &footprints[i], sizeof(row));
+        row.name[sizeof(row.name) - 1] = '\0';
+        out.print(F("  "));
+        out.print(row.name);
+        out.print(F("="));
+        out.println(row.bytes);
+    }
+}
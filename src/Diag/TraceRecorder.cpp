@@ -0,0 +1,221 @@
+#include "Diag/TraceRecorder.h"
+#include "Core/SystemCoordinator.h"
+#include "RFID/TagId.h"
+
+#if TRACE_CAPTURE > 0
+static_assert(TRACE_CAPTURE <= 0x7FFF, "TRACE_CAPTURE bytes must fit the ring index");
+static_assert(TRACE_CAPTURE >= 128, "TRACE_CAPTURE must hold a full chunk behind the one growing");
+
+static constexpr uint8_t GAP_MARKER = 0xC0;
+static constexpr uint8_t GAP_SECONDS = 0x20;
+static constexpr uint16_t MAX_GAP = 0x1FFF;
+static constexpr uint8_t MAX_DELTA_MS = 0xFF;
+static constexpr uint8_t MAX_CHUNK = 64;
+static constexpr uint16_t NO_CHUNK = 0xFFFF;
+
+static uint8_t ring[TRACE_CAPTURE];
+static uint16_t head = 0;
+static uint16_t count = 0;
+static uint16_t openChunk = NO_CHUNK; // header of the newest chunk while it can still grow
+static uint32_t lastMs = 0;
+static bool capturing = true;
+
+static uint16_t wrap(uint16_t idx)
+{
+    return idx >= TRACE_CAPTURE ? idx - TRACE_CAPTURE : idx;
+}
+
+static uint16_t oldest()
+{
+    return wrap(head + TRACE_CAPTURE - count);
+}
+
+static uint8_t recordLen(uint8_t hdr)
+{
+    return (hdr & GAP_MARKER) == GAP_MARKER ? 2 : 2 + (hdr & 0x3F) + 1;
+}
+
+static void makeRoom(uint8_t n)
+{
+    while (TRACE_CAPTURE - count < n)
+    {
+        uint16_t idx = oldest();
+        if (idx == openChunk)
+            openChunk = NO_CHUNK;
+        count -= recordLen(ring[idx]);
+    }
+}
+
+static void push(uint8_t b)
+{
+    ring[head] = b;
+    head = wrap(head + 1);
+    ++count;
+}
+
+void TraceRecorder::record(TraceSource src, uint8_t b)
+{
+    if (!capturing)
+        return;
+    uint32_t now = millis();
+    uint32_t dt = count ? now - lastMs : 0;
+    if (dt == 0 && openChunk != NO_CHUNK && (ring[openChunk] >> 6) == src &&
+        (ring[openChunk] & 0x3F) < MAX_CHUNK - 1)
+    {
+        makeRoom(1);
+        if (openChunk != NO_CHUNK)
+        {
+            ++ring[openChunk];
+            push(b);
+            return;
+        }
+    }
+    lastMs = now;
+    while (dt > MAX_DELTA_MS)
+    {
+        makeRoom(2);
+        if (dt > MAX_GAP)
+        {
+            uint32_t s = dt / 1000;
+            if (s > MAX_GAP)
+                s = MAX_GAP;
+            push(GAP_MARKER | GAP_SECONDS | (s >> 8));
+            push(s & 0xFF);
+            dt -= s * 1000;
+        }
+        else
+        {
+            push(GAP_MARKER | (dt >> 8));
+            push(dt & 0xFF);
+            dt = 0;
+        }
+    }
+    makeRoom(3);
+    openChunk = head;
+    push(static_cast<uint8_t>(src << 6));
+    push(static_cast<uint8_t>(dt));
+    push(b);
+}
+
+static uint32_t deltaOf(uint16_t idx)
+{
+    uint8_t hdr = ring[idx];
+    uint8_t b = ring[wrap(idx + 1)];
+    if ((hdr & GAP_MARKER) != GAP_MARKER)
+        return b;
+    uint32_t g = static_cast<uint16_t>(hdr & 0x1F) << 8 | b;
+    return (hdr & GAP_SECONDS) ? g * 1000 : g;
+}
+
+uint32_t TraceRecorder::oldestMs()
+{
+    // The oldest chunk's own delta (and any marker before it) points at
+    // chunks already dropped; everything after it leads up to lastMs.
+    uint32_t span = 0;
+    bool started = false;
+    uint16_t idx = oldest();
+    for (uint16_t n = 0; n < count;)
+    {
+        if (started)
+            span += deltaOf(idx);
+        else
+            started = (ring[idx] & GAP_MARKER) != GAP_MARKER;
+        uint8_t len = recordLen(ring[idx]);
+        n += len;
+        idx = wrap(idx + len);
+    }
+    return lastMs - span;
+}
+
+void TraceRecorder::setCapturing(bool on)
+{
+    capturing = on;
+}
+
+bool TraceRecorder::isCapturing()
+{
+    return capturing;
+}
+
+void TraceRecorder::clear()
+{
+    head = 0;
+    count = 0;
+    openChunk = NO_CHUNK;
+}
+
+uint16_t TraceRecorder::size()
+{
+    return count;
+}
+#endif
+
+void TraceRecorder::dump(Print &out, const SystemCoordinator &coord)
+{
+    bool was = isCapturing();
+    setCapturing(false);
+    out.print(F("TRACE v3 n="));
+    out.print(size());
+    out.print(F(" clock="));
+    out.print(coord.getClockMs());
+    out.print(F(" millis="));
+    out.print(millis());
+    // millis() of the newest chunk, to place the trace on the schedule clock.
+    out.print(F(" last="));
+#if TRACE_CAPTURE > 0
+    out.println(lastMs);
+#else
+    out.println(0);
+#endif
+    for (uint8_t i = 0; i < coord.getNumTags(); ++i)
+    {
+        uint8_t len = 0;
+        const uint8_t *id = coord.getTag(i, len);
+        const TagTransit *t = coord.getTransit(i);
+        out.print(F("G "));
+        printHexBytes(out, id, len);
+        // Learned statistics: passages gapMean gapDev transitMean readsMean.
+        out.print(' ');
+        out.print(t->passages);
+        out.print(' ');
+        out.print(t->gapMean);
+        out.print(' ');
+        out.print(t->gapDev);
+        out.print(' ');
+        out.print(t->transitMean);
+        out.print(' ');
+        out.println(t->readsMean);
+    }
+    for (uint8_t i = 0; i < coord.getIntervalCount(); ++i)
+    {
+        const IntervalRecord *r = coord.getInterval(i);
+        out.print(F("I "));
+        out.print(r->id);
+        out.print(' ');
+        out.print(r->startMin);
+        out.print(' ');
+        out.print(r->endMin);
+        out.print(' ');
+        out.print(r->daysMask);
+        out.print(' ');
+        out.println(r->enabled ? 1 : 0);
+    }
+#if TRACE_CAPTURE > 0
+    uint16_t idx = oldest();
+    for (uint16_t n = 0; n < count; ++n)
+    {
+        if (n % 32 == 0)
+        {
+            if (n)
+                out.println();
+            out.print(F("T "));
+        }
+        printHexBytes(out, &ring[idx], 1);
+        idx = wrap(idx + 1);
+    }
+    if (count)
+        out.println();
+#endif
+    out.println(F("END"));
+    setCapturing(was);
+}
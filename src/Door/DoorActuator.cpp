@@ -0,0 +1,100 @@
+#include "Door/DoorActuator.h"
+#include <Servo.h>
+
+static Servo doorServo;
+
+void DoorActuator::begin(uint8_t servoPin, uint32_t now)
+{
+    pin = servoPin;
+    attached = false;
+    // The flap may be anywhere after power-up, so hold "closed" for a full
+    // travel time before treating it as settled.
+    pulseUs = DOOR_PULSE_CLOSED_US;
+    fromUs = toUs = pulseUs;
+    moveMs = DOOR_TRAVEL_MS;
+    moveStartMs = now;
+    restSinceMs = now;
+    motion = DOOR_CLOSING;
+    writePulse(pulseUs);
+}
+
+void DoorActuator::resume(uint8_t servoPin, uint32_t now)
+{
+    pin = servoPin;
+    attached = false;
+    if (motion == DOOR_OPENING || motion == DOOR_CLOSING)
+    {
+        // Finish the interrupted move from wherever the last pulse left it.
+        startMove(toUs, motion, now);
+        return;
+    }
+    // At rest: re-assert the saved position, then settle and detach as usual.
+    restSinceMs = now;
+    writePulse(pulseUs);
+}
+
+void DoorActuator::startMove(uint16_t target, DoorMotion moving, uint32_t now)
+{
+    fromUs = pulseUs;
+    toUs = target;
+    uint16_t dist = (fromUs > toUs) ? fromUs - toUs : toUs - fromUs;
+    moveMs = static_cast<uint16_t>((static_cast<uint32_t>(dist) * DOOR_TRAVEL_MS) /
+                                   (DOOR_PULSE_OPEN_US - DOOR_PULSE_CLOSED_US));
+    moveStartMs = now;
+    motion = moving;
+    update(now);
+}
+
+void DoorActuator::open(uint32_t now)
+{
+    if (motion == DOOR_OPEN || motion == DOOR_OPENING)
+        return;
+    startMove(DOOR_PULSE_OPEN_US, DOOR_OPENING, now);
+}
+
+void DoorActuator::close(uint32_t now)
+{
+    if (motion == DOOR_CLOSED || motion == DOOR_CLOSING)
+        return;
+    startMove(DOOR_PULSE_CLOSED_US, DOOR_CLOSING, now);
+}
+
+void DoorActuator::writePulse(uint16_t us)
+{
+    pulseUs = us;
+    // Writing before attach makes the very first frame carry this pulse.
+    doorServo.writeMicroseconds(us);
+    if (!attached)
+    {
+        doorServo.attach(pin);
+        attached = true;
+    }
+}
+
+void DoorActuator::update(uint32_t now)
+{
+    if (motion == DOOR_OPENING || motion == DOOR_CLOSING)
+    {
+        uint32_t elapsed = now - moveStartMs;
+        if (elapsed >= moveMs)
+        {
+            writePulse(toUs);
+            motion = (motion == DOOR_OPENING) ? DOOR_OPEN : DOOR_CLOSED;
+            restSinceMs = now;
+            return;
+        }
+        // smoothstep in Q8: s = t^2 (3 - 2t), t = elapsed / moveMs.
+        uint32_t t = (static_cast<uint32_t>(elapsed) << 8) / moveMs;
+        uint32_t s = (t * t * (768 - 2 * t)) >> 16;
+        int32_t span = static_cast<int32_t>(toUs) - static_cast<int32_t>(fromUs);
+        uint16_t us = static_cast<uint16_t>(fromUs + (span * static_cast<int32_t>(s)) / 256);
+        if (us != pulseUs || !attached)
+            writePulse(us);
+        return;
+    }
+    if (attached && (now - restSinceMs) >= DOOR_SETTLE_MS)
+    {
+        doorServo.detach();
+        attached = false;
+    }
+}
\ No newline at end of file
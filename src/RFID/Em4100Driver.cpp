@@ -0,0 +1,50 @@
+#include "RFID/Em4100Driver.h"
+#include "RFID/TagId.h"
+#include <string.h>
+
+void Em4100Driver::reset()
+{
+    inFrame = false;
+    nibbles = 0;
+}
+
+bool Em4100Driver::feed(uint8_t b)
+{
+    if (b == 0x02)
+    {
+        inFrame = true;
+        nibbles = 0;
+        memset(raw, 0, sizeof(raw));
+        return false;
+    }
+    if (!inFrame)
+        return false;
+    if (b == 0x03)
+    {
+        bool ok = (nibbles == 2 * sizeof(raw));
+        uint8_t x = 0;
+        for (uint8_t i = 0; i < ID_LEN; ++i)
+            x ^= raw[i];
+        reset();
+        if (!ok || x != raw[ID_LEN])
+        {
+            ++stats.badFrames;
+            return false;
+        }
+        memcpy(idBuf, raw, ID_LEN);
+        ++stats.frames;
+        stats.seen(millis());
+        return true;
+    }
+    if (b == '\r' || b == '\n')
+        return false;
+    int8_t n = hexNibble(b);
+    if (n < 0 || nibbles >= 2 * sizeof(raw))
+    {
+        reset();
+        return false;
+    }
+    raw[nibbles >> 1] |= (nibbles & 1) ? n : (n << 4);
+    ++nibbles;
+    return false;
+}
\ No newline at end of file
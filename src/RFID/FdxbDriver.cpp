@@ -0,0 +1,104 @@
+#include "RFID/FdxbDriver.h"
+#include "RFID/TagId.h"
+
+void FdxbDriver::pack(uint16_t country, uint64_t national, uint8_t *id)
+{
+    uint64_t value = (static_cast<uint64_t>(country) << 38) | national;
+    for (int8_t i = ID_LEN - 1; i >= 0; --i)
+    {
+        id[i] = static_cast<uint8_t>(value);
+        value >>= 8;
+    }
+}
+
+bool FdxbDriver::fromCertificate(const char *digits, uint8_t *id)
+{
+    uint16_t country = 0;
+    uint64_t national = 0;
+    uint8_t n = 0;
+    for (; digits[n]; ++n)
+    {
+        if (n == 15 || digits[n] < '0' || digits[n] > '9')
+            return false;
+        uint8_t d = digits[n] - '0';
+        if (n < 3)
+            country = country * 10 + d;
+        else
+            national = national * 10 + d;
+    }
+    if (n != 15 || national > NATIONAL_MAX || country > COUNTRY_MAX)
+        return false;
+    pack(country, national, id);
+    return true;
+}
+
+void FdxbDriver::reset()
+{
+    inFrame = false;
+    count = 0;
+}
+
+bool FdxbDriver::feed(uint8_t b)
+{
+    if (b == 0x02 && (!inFrame || count < PAYLOAD_LEN))
+    {
+        // STX never occurs in the ASCII payload, but may be a checksum byte.
+        inFrame = true;
+        count = 0;
+        sum = 0;
+        national = 0;
+        country = 0;
+        return false;
+    }
+    if (!inFrame)
+        return false;
+
+    if (count < PAYLOAD_LEN)
+    {
+        sum ^= b;
+        if (count < 14)
+        {
+            int8_t n = hexNibble(b);
+            if (n < 0)
+            {
+                reset();
+                return false;
+            }
+            // Both fields are sent least significant nibble first.
+            if (count < 10)
+                national |= static_cast<uint64_t>(n) << (4 * count);
+            else
+                country |= static_cast<uint16_t>(n) << (4 * (count - 10));
+        }
+        ++count;
+        return false;
+    }
+    if (count == PAYLOAD_LEN)
+    {
+        check = b;
+        ++count;
+        return false;
+    }
+    if (count == PAYLOAD_LEN + 1)
+    {
+        bool ok = (check == sum) && (static_cast<uint8_t>(~b) == sum);
+        ++count;
+        if (!ok)
+        {
+            ++stats.badFrames;
+            reset();
+        }
+        return false;
+    }
+
+    reset();
+    if (b != 0x03 || national > NATIONAL_MAX || country > COUNTRY_MAX)
+    {
+        ++stats.badFrames;
+        return false;
+    }
+    ++stats.frames;
+    stats.seen(millis());
+    pack(country, national, idBuf);
+    return true;
+}
\ No newline at end of file
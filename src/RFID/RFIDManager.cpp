@@ -1,125 +1,126 @@
 #include "RFID/RFIDManager.h"
+#include "Diag/TraceRecorder.h"
+#include <avr/pgmspace.h>
 #include <string.h>
 
-static const uint8_t ReadMultiCmd[10] = {
-    0xBB, 0x00, 0x27, 0x00, 0x03, 0x22, 0xFF, 0xFF, 0x4A, 0x7E};
-static unsigned long lastCommandTime = 0;
-static constexpr unsigned long READ_CMD_PERIOD_MS = 1000UL;
+template <class Driver>
+RFIDManagerT<Driver>::RFIDManagerT(SystemCoordinator &coord, Stream &readerPort, ReaderSide readerSide)
+    : coordinator(coord), port(readerPort), side(readerSide)
+{
+}
 
-RFIDManager::RFIDManager(SystemCoordinator &coord)
-    : coordinator(coord)
+template <class Driver>
+void RFIDManagerT<Driver>::enrollDefaults(SystemCoordinator &coord)
 {
+    typedef DefaultTags<Driver::ID_LEN> Defaults;
+    for (uint8_t i = 0; i < Defaults::COUNT; ++i)
+    {
+        uint8_t id[Driver::ID_LEN];
+        memcpy_P(id, Defaults::at(i), sizeof(id));
+        coord.addTag(id, sizeof(id));
+    }
 }
 
-void RFIDManager::begin()
+template <class Driver>
+void RFIDManagerT<Driver>::begin()
 {
 #if DEBUG_MODE
     DBG_SL("[RFID] begin");
 #endif
     resetStates();
-    lastCommandTime = 0;
+    ReaderMonitor::attach(&driver.health(), side);
 }
 
-void RFIDManager::resetStates()
+template <class Driver>
+void RFIDManagerT<Driver>::resetStates()
 {
-    state = 0;
-    codeState = 0;
-    dataAdd = 0;
-    epcIndex = 0;
-    memset(epcBuf, 0, sizeof(epcBuf));
+    driver.reset();
+    // Reads folded in before the pause must not surface as trailing edges.
+    sightings.clear();
 }
 
-static void SendReadCommand()
+template <class Driver>
+void RFIDManagerT<Driver>::handleIdComplete()
 {
-    Serial.write(ReadMultiCmd, sizeof(ReadMultiCmd));
+    const uint8_t *id = driver.id();
+    uint8_t len = driver.idLen();
+    uint16_t hash = SightingCache::hashOf(id, len);
+    uint32_t now = millis();
+    SightingEntry *e = sightings.find(id, len, hash, coordinator.getTagTableVersion());
+    if (!e)
+    {
+        e = &sightings.insert(id, len, hash, coordinator.findTagIndex(id, len), now);
 #if DEBUG_MODE
-    DBG_SL("[RFID] sent cmd");
+        DBG_S("[RFID] ID:");
+        for (uint8_t i = 0; i < len; ++i)
+        {
+            DBG_HEX(id[i]);
+            DBG_S(" ");
+        }
+        DBG_S("\n");
+        if (e->tagIdx >= 0)
+            DBG_SL("[RFID] known -> notify");
+        else
+            DBG_SL("[RFID] unknown");
 #endif
+    }
+    if (sightings.addRead(*e, driver.rssi(), now))
+        emit(*e, now);
 }
 
-void RFIDManager::handleEpcComplete()
+template <class Driver>
+void RFIDManagerT<Driver>::emit(SightingEntry &e, uint32_t now)
 {
-#if DEBUG_MODE
-    DBG_S("[RFID] EPC:");
-    for (uint8_t i = 0; i < 12; ++i)
-    {
-        DBG_HEX(epcBuf[i]);
-        DBG_S(" ");
-    }
-    DBG_S("\n");
-#endif
-    if (coordinator.isValidTag(epcBuf, 12))
-    {
-#if DEBUG_MODE
-        DBG_SL("[RFID] known -> notify");
-#endif
-        coordinator.onTagDetected(epcBuf, 12);
-    }
-    else
-    {
-#if DEBUG_MODE
-        DBG_SL("[RFID] unknown");
-#endif
-    }
+    TagSighting s;
+    s.reads = e.reads;
+    s.rssi = e.peakRssi;
+    s.side = side;
+    uint32_t age = now - e.lastReadMs;
+    s.ageMs = age > UINT16_MAX ? UINT16_MAX : static_cast<uint16_t>(age);
+    s.gapMs = e.maxGapMs;
+    coordinator.onTagSighting(static_cast<uint8_t>(e.tagIdx), s);
+    sightings.openWindow(e, now);
 }
 
-void RFIDManager::loop()
+template <class Driver>
+void RFIDManagerT<Driver>::loop()
 {
-    if (!coordinator.isRfidEnabled())
+    bool enabled = coordinator.isRfidEnabled();
+    if (enabled && suspended)
     {
+        suspended = false;
         resetStates();
-        return;
-    }
-
-    unsigned long now = millis();
-    if ((now - lastCommandTime) >= READ_CMD_PERIOD_MS)
-    {
-        lastCommandTime = now;
-        SendReadCommand();
     }
 
-    while (Serial.available() > 0)
+    // Parsed even while disabled, so the driver sees the stop acknowledged
+    // and nothing stale is left in the UART to open the door later; only
+    // the IDs are dropped.
+    while (port.available() > 0)
     {
-        int in = Serial.read();
+        int in = port.read();
         if (in < 0)
             break;
-        uint8_t b = static_cast<uint8_t>(in);
-
-        if ((b == 0x02) && (state == 0))
-        {
-            state = 1;
-            continue;
-        }
-        else if ((state == 1) && (b == 0x22) && (codeState == 0))
-        {
-            codeState = 1;
-            dataAdd = 3;
-            epcIndex = 0;
-            continue;
-        }
-        else if (codeState == 1)
-        {
-            dataAdd++;
-
-            if ((dataAdd >= 9) && (dataAdd <= 20))
-            {
-                if (epcIndex < sizeof(epcBuf))
-                {
-                    epcBuf[epcIndex++] = b;
-                }
-            }
-            else if (dataAdd >= 21)
-            {
-                if (epcIndex == (int)sizeof(epcBuf))
-                {
-                    handleEpcComplete();
-                }
-                resetStates();
-            }
-        }
-        else
+        TraceRecorder::record(side == READER_INSIDE ? TRACE_RFID2 : TRACE_RFID, static_cast<uint8_t>(in));
+        if (driver.feed(static_cast<uint8_t>(in)) && enabled)
+            handleIdComplete();
+    }
+    uint32_t now = millis();
+    if (!enabled)
+    {
+        if (!suspended)
         {
-            resetStates();
+            suspended = true;
+            sightings.clear(); // as in resetStates()
         }
+        driver.suspend(port, now);
+        return;
     }
-}
\ No newline at end of file
+    while (SightingEntry *e = sightings.due(now))
+        emit(*e, now);
+    // After draining, so the supervisor sees this loop's frames.
+    driver.poll(port, now);
+}
+
+template class RFIDManagerT<UhfM100Driver>;
+template class RFIDManagerT<Em4100Driver>;
+template class RFIDManagerT<FdxbDriver>;
\ No newline at end of file
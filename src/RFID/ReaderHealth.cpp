@@ -0,0 +1,50 @@
+#include "RFID/ReaderHealth.h"
+
+static const ReaderHealth *readers[ReaderMonitor::MAX_READERS];
+static ReaderSide sides[ReaderMonitor::MAX_READERS];
+static uint8_t readerCount = 0;
+
+void ReaderMonitor::attach(const ReaderHealth *health, ReaderSide side)
+{
+    for (uint8_t i = 0; i < readerCount; ++i)
+    {
+        if (readers[i] == health)
+            return;
+    }
+    if (readerCount >= MAX_READERS)
+        return;
+    readers[readerCount] = health;
+    sides[readerCount] = side;
+    ++readerCount;
+}
+
+void ReaderMonitor::report(Print &out, uint32_t now)
+{
+    for (uint8_t i = 0; i < readerCount; ++i)
+    {
+        const ReaderHealth &h = *readers[i];
+        out.print(F("rdr"));
+        out.print(i);
+        if (sides[i] == READER_INSIDE)
+            out.print(F(" side=in"));
+        else if (sides[i] == READER_OUTSIDE)
+            out.print(F(" side=out"));
+        if (h.supervised)
+            out.print(F(" up="));
+        else
+            out.print(F(" seen="));
+        out.print(h.responsive ? 1 : 0);
+        out.print(F(" uptime_s="));
+        out.print(h.responsive ? (now - h.upSinceMs) / 1000UL : 0UL);
+        out.print(F(" frames="));
+        out.print(h.frames);
+        out.print(F(" bad="));
+        out.print(h.badFrames);
+        out.print(F(" timeouts="));
+        out.print(h.timeouts);
+        out.print(F(" errors="));
+        out.print(h.errorFrames);
+        out.print(F(" reinits="));
+        out.println(h.reinits);
+    }
+}
@@ -0,0 +1,105 @@
+#include "RFID/SightingCache.h"
+#include <string.h>
+
+void SightingCache::clear()
+{
+    for (uint8_t i = 0; i < SIGHTING_CACHE_SIZE; ++i)
+        entries[i].used = false;
+}
+
+uint16_t SightingCache::hashOf(const uint8_t *id, uint8_t len)
+{
+    uint16_t h = len;
+    for (uint8_t i = 0; i < len; ++i)
+        h = static_cast<uint16_t>(((h << 5) | (h >> 11)) ^ id[i]);
+    return h;
+}
+
+SightingEntry *SightingCache::find(const uint8_t *id, uint8_t len, uint16_t hash, uint8_t tableVersion)
+{
+    if (tableVersion != version)
+    {
+        // Tags were added or removed: cached indices and negatives are stale.
+        clear();
+        version = tableVersion;
+        return nullptr;
+    }
+    for (uint8_t i = 0; i < SIGHTING_CACHE_SIZE; ++i)
+    {
+        SightingEntry &e = entries[i];
+        if (e.used && e.hash == hash && e.len == len && memcmp(e.epc, id, len) == 0)
+            return &e;
+    }
+    return nullptr;
+}
+
+SightingEntry &SightingCache::insert(const uint8_t *id, uint8_t len, uint16_t hash, int8_t tagIdx, uint32_t now)
+{
+    uint8_t victim = 0;
+    uint32_t oldestAge = 0;
+    for (uint8_t i = 0; i < SIGHTING_CACHE_SIZE; ++i)
+    {
+        if (!entries[i].used)
+        {
+            victim = i;
+            break;
+        }
+        uint32_t age = now - entries[i].lastReadMs;
+        if (age >= oldestAge)
+        {
+            oldestAge = age;
+            victim = i;
+        }
+    }
+    SightingEntry &e = entries[victim];
+    if (len > sizeof(e.epc))
+        len = sizeof(e.epc);
+    memcpy(e.epc, id, len);
+    e.len = len;
+    e.hash = hash;
+    e.tagIdx = tagIdx;
+    e.used = true;
+    e.lastReadMs = now;
+    e.reads = 0;
+    e.maxGapMs = 0;
+    e.peakRssi = INT8_MIN;
+    // Backdate the window so the first read is emitted immediately.
+    e.windowStart = now - SIGHTING_WINDOW_MS;
+    return e;
+}
+
+bool SightingCache::addRead(SightingEntry &e, int8_t rssi, uint32_t now)
+{
+    uint32_t gap = now - e.lastReadMs;
+    if (gap > e.maxGapMs)
+        e.maxGapMs = gap > UINT16_MAX ? UINT16_MAX : static_cast<uint16_t>(gap);
+    e.lastReadMs = now;
+    if (e.reads < 0xFF)
+        ++e.reads;
+    if (rssi > e.peakRssi)
+        e.peakRssi = rssi;
+    if (e.tagIdx >= 0 && (now - e.windowStart) >= SIGHTING_WINDOW_MS)
+        return true;
+    if (suppressedReads < 0xFFFF)
+        ++suppressedReads;
+    return false;
+}
+
+void SightingCache::openWindow(SightingEntry &e, uint32_t now)
+{
+    e.windowStart = now;
+    e.reads = 0;
+    e.maxGapMs = 0;
+    e.peakRssi = INT8_MIN;
+}
+
+SightingEntry *SightingCache::due(uint32_t now)
+{
+    for (uint8_t i = 0; i < SIGHTING_CACHE_SIZE; ++i)
+    {
+        SightingEntry &e = entries[i];
+        if (e.used && e.tagIdx >= 0 && e.reads > 0 && (now - e.windowStart) >= SIGHTING_WINDOW_MS)
+            return &e;
+    }
+    return nullptr;
+}
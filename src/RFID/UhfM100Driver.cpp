@@ -0,0 +1,281 @@
+#include "RFID/UhfM100Driver.h"
+#include <string.h>
+
+static constexpr uint8_t FRAME_HEADER = 0xBB;
+static constexpr uint8_t FRAME_END = 0x7E;
+static constexpr uint8_t TYPE_COMMAND = 0x00;
+static constexpr uint8_t TYPE_RESPONSE = 0x01;
+static constexpr uint8_t TYPE_NOTICE = 0x02;
+static constexpr uint8_t CMD_INVENTORY = 0x22;
+static constexpr uint8_t CMD_MULTI_POLL = 0x27;
+static constexpr uint8_t CMD_STOP_POLL = 0x28;
+static constexpr uint8_t CMD_SET_POWER = 0xB6;
+static constexpr uint8_t CMD_ERROR = 0xFF;
+static constexpr uint8_t ERR_NO_TAG = 0x15;
+
+// Notice payload = RSSI(1) + PC(2) + EPC + CRC(2).
+static constexpr uint8_t NOTICE_OVERHEAD = 5;
+
+void UhfM100Driver::reset()
+{
+    rxState = RX_HEADER;
+    link = LINK_IDLE;
+    frameSeen = false;
+    errorSeen = false;
+    ackCmd = 0;
+    answered = false;
+    failures = 0;
+    stats.supervised = true;
+}
+
+void UhfM100Driver::send(Stream &port, uint8_t cmd, const uint8_t *data, uint8_t len, uint32_t now)
+{
+    uint8_t sum = TYPE_COMMAND + cmd + len;
+    port.write(FRAME_HEADER);
+    port.write(TYPE_COMMAND);
+    port.write(cmd);
+    port.write(static_cast<uint8_t>(0));
+    port.write(len);
+    for (uint8_t i = 0; i < len; ++i)
+    {
+        port.write(data[i]);
+        sum += data[i];
+    }
+    port.write(sum);
+    port.write(FRAME_END);
+    sentMs = now;
+    answered = false;
+    ackCmd = 0;
+    errorSeen = false;
+    burstFrames = 0;
+}
+
+void UhfM100Driver::sendPoll(Stream &port, uint32_t now)
+{
+    const uint8_t args[3] = {CMD_INVENTORY, static_cast<uint8_t>(UHF_POLL_ROUNDS >> 8),
+                             static_cast<uint8_t>(UHF_POLL_ROUNDS & 0xFF)};
+    send(port, CMD_MULTI_POLL, args, sizeof(args), now);
+    link = LINK_POLLING;
+}
+
+void UhfM100Driver::beginReinit(Stream &port, uint32_t now)
+{
+    ++stats.reinits;
+#if DEBUG_MODE
+    DBG_S("[RFID] reinit #");
+    DBG_VL(stats.reinits);
+#endif
+    send(port, CMD_STOP_POLL, nullptr, 0, now);
+    link = LINK_STOPPING;
+}
+
+void UhfM100Driver::fail(Stream &port, uint32_t now)
+{
+    if (++failures < UHF_MAX_FAILURES)
+    {
+        link = LINK_IDLE;
+        return;
+    }
+    if (stats.responsive)
+    {
+        stats.responsive = false;
+#if DEBUG_MODE
+        DBG_SL("[RFID] reader down");
+#endif
+    }
+    failures = 0;
+    beginReinit(port, now);
+}
+
+void UhfM100Driver::poll(Stream &port, uint32_t now)
+{
+    if (frameSeen)
+    {
+        frameSeen = false;
+        answered = true;
+        lastFrameMs = now;
+        stats.seen(now);
+    }
+    bool timedOut = !answered && now - sentMs >= UHF_RESPONSE_TIMEOUT_MS;
+
+    switch (link)
+    {
+    case LINK_IDLE:
+        sendPoll(port, now);
+        break;
+    case LINK_POLLING:
+        if (errorSeen)
+        {
+            fail(port, now);
+        }
+        else if (timedOut)
+        {
+            ++stats.timeouts;
+            fail(port, now);
+        }
+        else if (answered && (burstFrames >= UHF_POLL_ROUNDS || now - lastFrameMs >= UHF_ROUND_QUIET_MS ||
+                              now - sentMs >= UHF_BURST_MAX_MS))
+        {
+            // Burst finished: the module is healthy, queue the next one now.
+            failures = 0;
+            sendPoll(port, now);
+        }
+        break;
+    case LINK_STOPPING:
+        if (ackCmd == CMD_STOP_POLL)
+        {
+            const uint8_t power[2] = {static_cast<uint8_t>(UHF_TX_POWER_CDBM >> 8),
+                                      static_cast<uint8_t>(UHF_TX_POWER_CDBM & 0xFF)};
+            send(port, CMD_SET_POWER, power, sizeof(power), now);
+            link = LINK_POWERING;
+        }
+        else if (now - sentMs >= UHF_RESPONSE_TIMEOUT_MS)
+        {
+            ++stats.timeouts;
+            link = LINK_BACKOFF;
+        }
+        break;
+    case LINK_POWERING:
+        if (ackCmd == CMD_SET_POWER)
+        {
+#if DEBUG_MODE
+            DBG_SL("[RFID] reader up");
+#endif
+            sendPoll(port, now);
+        }
+        else if (now - sentMs >= UHF_RESPONSE_TIMEOUT_MS)
+        {
+            ++stats.timeouts;
+            link = LINK_BACKOFF;
+        }
+        break;
+    case LINK_BACKOFF:
+        if (now - sentMs >= UHF_REINIT_BACKOFF_MS)
+            beginReinit(port, now);
+        break;
+    case LINK_SUSPENDED:
+        break;
+    }
+}
+
+void UhfM100Driver::suspend(Stream &port, uint32_t now)
+{
+    if (frameSeen)
+    {
+        frameSeen = false;
+        lastFrameMs = now;
+        stats.seen(now);
+    }
+    if (link != LINK_SUSPENDED)
+    {
+        send(port, CMD_STOP_POLL, nullptr, 0, now);
+        link = LINK_SUSPENDED;
+    }
+    else if (now - sentMs >= UHF_RESPONSE_TIMEOUT_MS && now - lastFrameMs < UHF_ROUND_QUIET_MS)
+    {
+        // Still inventorying: the stop was lost or the module hung.
+        send(port, CMD_STOP_POLL, nullptr, 0, now);
+    }
+}
+
+// A checksummed frame is in; true if it carried a tag.
+bool UhfM100Driver::frameComplete()
+{
+    ++stats.frames;
+    frameSeen = true;
+    if (rxType == TYPE_NOTICE && rxCmd == CMD_INVENTORY)
+    {
+        if (rxLen <= NOTICE_OVERHEAD || rxLen - NOTICE_OVERHEAD > MAX_TAG_ID_LEN)
+            return false;
+        epcLen = rxLen - NOTICE_OVERHEAD;
+        lastRssi = static_cast<int8_t>(payload[0]);
+        memcpy(epcBuf, payload + 3, epcLen);
+        return true;
+    }
+    if (rxType == TYPE_RESPONSE)
+    {
+        ackCmd = rxCmd;
+        if (rxCmd == CMD_ERROR && rxLen >= 1 && payload[0] == ERR_NO_TAG)
+        {
+            // A round's only frame when it found nothing; tag rounds send one
+            // notice per tag, so those are not counted.
+            ++burstFrames;
+        }
+        else if (rxCmd == CMD_ERROR && rxLen >= 1)
+        {
+            ++stats.errorFrames;
+            errorSeen = true;
+#if DEBUG_MODE
+            DBG_S("[RFID] error 0x");
+            DBG_HEXL(payload[0]);
+#endif
+        }
+    }
+    return false;
+}
+
+bool UhfM100Driver::feed(uint8_t b)
+{
+    switch (rxState)
+    {
+    case RX_HEADER:
+        if (b == FRAME_HEADER)
+            rxState = RX_TYPE;
+        return false;
+    case RX_TYPE:
+        rxType = b;
+        rxSum = b;
+        rxState = RX_CMD;
+        return false;
+    case RX_CMD:
+        rxCmd = b;
+        rxSum += b;
+        rxState = RX_LEN_HI;
+        return false;
+    case RX_LEN_HI:
+        rxLen = static_cast<uint16_t>(b) << 8;
+        rxSum += b;
+        rxState = RX_LEN_LO;
+        return false;
+    case RX_LEN_LO:
+        rxLen |= b;
+        rxSum += b;
+        rxPos = 0;
+        if (rxLen > MAX_FRAME_PAYLOAD)
+        {
+            ++stats.badFrames;
+            rxState = RX_HEADER;
+            return false;
+        }
+        rxState = rxLen ? RX_PAYLOAD : RX_SUM;
+        return false;
+    case RX_PAYLOAD:
+        // Long replies (e.g. version strings) are checksummed but not kept.
+        if (rxPos < MAX_PAYLOAD)
+            payload[rxPos] = b;
+        rxSum += b;
+        if (++rxPos == rxLen)
+            rxState = RX_SUM;
+        return false;
+    case RX_SUM:
+        if (b != rxSum)
+        {
+            ++stats.badFrames;
+            // The bad byte may be the start of the next frame.
+            rxState = (b == FRAME_HEADER) ? RX_TYPE : RX_HEADER;
+            return false;
+        }
+        rxState = RX_END;
+        return false;
+    case RX_END:
+        rxState = RX_HEADER;
+        if (b != FRAME_END)
+        {
+            ++stats.badFrames;
+            return false;
+        }
+        return frameComplete();
+    }
+    rxState = RX_HEADER;
+    return false;
+}
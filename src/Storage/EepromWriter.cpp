@@ -0,0 +1,175 @@
+#include "Storage/EepromWriter.h"
+#include "Core/Config.h"
+#include <avr/io.h>
+#include <avr/eeprom.h>
+#include <avr/interrupt.h>
+#include <util/atomic.h>
+
+static_assert((EEPROM_QUEUE_SIZE & (EEPROM_QUEUE_SIZE - 1)) == 0, "EEPROM_QUEUE_SIZE must be a power of two");
+static constexpr uint8_t QUEUE_MASK = EEPROM_QUEUE_SIZE - 1;
+
+// Queue shared with the ISR: the main loop appends or patches under
+// ATOMIC_BLOCK, the ISR pops from the head.
+static uint16_t queueAddr[EEPROM_QUEUE_SIZE];
+static uint8_t queueValue[EEPROM_QUEUE_SIZE];
+static volatile uint8_t queueHead = 0;
+static volatile uint8_t queueCount = 0;
+// Byte currently being programmed, so read() need not wait for it.
+static volatile bool inFlight = false;
+static volatile uint16_t inFlightAddr = 0;
+static volatile uint8_t inFlightValue = 0;
+static volatile uint16_t written = 0;
+static volatile uint16_t skipped = 0;
+
+ISR(EE_READY_vect)
+{
+    // Fires whenever EEPE is clear and EERIE set: the previous byte is done.
+    inFlight = false;
+    while (queueCount)
+    {
+        uint8_t h = queueHead;
+        uint16_t addr = queueAddr[h];
+        uint8_t value = queueValue[h];
+        queueHead = (h + 1) & QUEUE_MASK;
+        --queueCount;
+        EEAR = addr;
+        EECR |= _BV(EERE);
+        if (EEDR == value)
+        {
+            ++skipped;
+            continue;
+        }
+        EEDR = value;
+        // EEMPE then EEPE within four cycles; interrupts are off in here.
+        EECR |= _BV(EEMPE);
+        EECR |= _BV(EEPE);
+        inFlightAddr = addr;
+        inFlightValue = value;
+        inFlight = true;
+        ++written;
+        return;
+    }
+    EECR &= static_cast<uint8_t>(~_BV(EERIE));
+}
+
+// Newest queued entry for addr, or -1. Caller holds interrupts off.
+static int8_t findQueued(uint16_t addr)
+{
+    for (uint8_t n = queueCount; n > 0; --n)
+    {
+        uint8_t i = (queueHead + n - 1) & QUEUE_MASK;
+        if (queueAddr[i] == addr)
+            return static_cast<int8_t>(i);
+    }
+    return -1;
+}
+
+bool EepromWriter::write(uint16_t addr, uint8_t value)
+{
+    if (addr > E2END)
+        return false;
+    bool accepted = true;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+    {
+        int8_t i = findQueued(addr);
+        if (i >= 0)
+        {
+            queueValue[i] = value;
+        }
+        else if (!(EECR & _BV(EEPE)) && eeprom_read_byte(reinterpret_cast<const uint8_t *>(addr)) == value)
+        {
+            // Only compared while idle: a read during programming would stall.
+            ++skipped;
+        }
+        else if (queueCount == EEPROM_QUEUE_SIZE)
+        {
+            accepted = false;
+        }
+        else
+        {
+            uint8_t t = (queueHead + queueCount) & QUEUE_MASK;
+            queueAddr[t] = addr;
+            queueValue[t] = value;
+            ++queueCount;
+            EECR |= _BV(EERIE);
+        }
+    }
+    return accepted;
+}
+
+uint8_t EepromWriter::writeBlock(uint16_t addr, const void *src, uint8_t len)
+{
+    const uint8_t *p = static_cast<const uint8_t *>(src);
+    uint8_t n = 0;
+    while (n < len && write(addr + n, p[n]))
+        ++n;
+    return n;
+}
+
+uint8_t EepromWriter::read(uint16_t addr) const
+{
+    // EEPE polled and EEAR/EERE set under one ATOMIC_BLOCK, so the ISR cannot
+    // start the next queued byte in between; interrupts get in between polls.
+    for (;;)
+    {
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+        {
+            int8_t i = findQueued(addr);
+            if (i >= 0)
+                return queueValue[i];
+            if (inFlight && inFlightAddr == addr)
+                return inFlightValue;
+            if (!(EECR & _BV(EEPE)))
+            {
+                EEAR = addr;
+                EECR |= _BV(EERE);
+                return EEDR;
+            }
+        }
+    }
+}
+
+void EepromWriter::readBlock(uint16_t addr, void *dst, uint8_t len) const
+{
+    uint8_t *p = static_cast<uint8_t *>(dst);
+    for (uint8_t n = 0; n < len; ++n)
+        p[n] = read(addr + n);
+}
+
+bool EepromWriter::busy() const
+{
+    // EECR first: on the host model, reading it is what lets time pass.
+    return (EECR & _BV(EEPE)) || queueCount != 0 || inFlight;
+}
+
+uint8_t EepromWriter::freeSlots() const
+{
+    return EEPROM_QUEUE_SIZE - queueCount;
+}
+
+void EepromWriter::flush()
+{
+    while (busy())
+    {
+    }
+}
+
+uint16_t EepromWriter::getWritten() const
+{
+    uint16_t n;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+    {
+        n = written;
+    }
+    return n;
+}
+
+uint16_t EepromWriter::getSkipped() const
+{
+    uint16_t n;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+    {
+        n = skipped;
+    }
+    return n;
+}
@@ -0,0 +1,169 @@
+#include "Storage/TableStore.h"
+#include <avr/io.h>
+#include <string.h>
+
+static constexpr uint16_t INTERVAL_MAGIC = 0x4956 ^ (sizeof(IntervalRecord) << 8) ^ MAX_INTERVALS;
+static constexpr uint16_t TAG_MAGIC = 0x5447 ^ (MAX_TAG_ID_LEN << 8) ^ MAX_TAGS;
+static constexpr uint16_t HEADER_LEN = 3;
+static constexpr uint16_t INTERVAL_SLOT_LEN = sizeof(IntervalRecord) + 1;
+static constexpr uint16_t TAG_SLOT_LEN = 1 + MAX_TAG_ID_LEN + 1;
+static constexpr uint16_t INTERVALS_ADDR = EEPROM_TABLES_ADDR;
+static constexpr uint16_t TAGS_ADDR = INTERVALS_ADDR + HEADER_LEN + MAX_INTERVALS * INTERVAL_SLOT_LEN;
+static_assert(TAGS_ADDR + HEADER_LEN + MAX_TAGS * TAG_SLOT_LEN <= E2END + 1UL, "tables do not fit the EEPROM");
+
+// Sweep order: interval slots, interval header, tag slots, tag header. Each
+// header is written after its slots, so a grown count never points at slots
+// not yet stored.
+static constexpr uint8_t STEP_INTERVAL_HEADER = MAX_INTERVALS;
+static constexpr uint8_t STEP_FIRST_TAG = STEP_INTERVAL_HEADER + 1;
+static constexpr uint8_t STEP_TAG_HEADER = STEP_FIRST_TAG + MAX_TAGS;
+
+static uint16_t intervalAddr(uint8_t slot)
+{
+    return INTERVALS_ADDR + HEADER_LEN + slot * INTERVAL_SLOT_LEN;
+}
+
+static uint16_t tagAddr(uint8_t slot)
+{
+    return TAGS_ADDR + HEADER_LEN + slot * TAG_SLOT_LEN;
+}
+
+// A slot torn by a power cut mid-write fails this and is dropped on load.
+static uint8_t checkByte(const void *data, uint8_t len)
+{
+    const uint8_t *p = static_cast<const uint8_t *>(data);
+    uint8_t c = 0xA5;
+    for (uint8_t i = 0; i < len; ++i)
+        c = static_cast<uint8_t>(((c << 1) | (c >> 7)) ^ p[i]);
+    return c;
+}
+
+TableStore::TableStore(SystemCoordinator &coord, EepromWriter &eeprom)
+    : coordinator(coord), writer(eeprom)
+{
+}
+
+uint8_t TableStore::load()
+{
+    cursor = 0;
+    uint8_t restored = loadIntervals();
+    restored += loadTags();
+    return restored;
+}
+
+uint8_t TableStore::loadIntervals()
+{
+    uint16_t magic = 0;
+    writer.readBlock(INTERVALS_ADDR, &magic, sizeof(magic));
+    uint8_t count = writer.read(INTERVALS_ADDR + 2);
+    if (magic != INTERVAL_MAGIC || count > MAX_INTERVALS)
+        return 0;
+    uint8_t restored = 0;
+    for (uint8_t i = 0; i < count; ++i)
+    {
+        IntervalRecord rec;
+        writer.readBlock(intervalAddr(i), &rec, sizeof(rec));
+        if (writer.read(intervalAddr(i) + sizeof(rec)) != checkByte(&rec, sizeof(rec)))
+            continue;
+        rec.id[sizeof(rec.id) - 1] = '\0';
+        if (coordinator.putInterval(rec))
+            ++restored;
+    }
+#if DEBUG_MODE
+    DBG_S("[EE] intervals restored=");
+    DBG_VL(restored);
+#endif
+    return restored;
+}
+
+uint8_t TableStore::loadTags()
+{
+    uint16_t magic = 0;
+    writer.readBlock(TAGS_ADDR, &magic, sizeof(magic));
+    uint8_t count = writer.read(TAGS_ADDR + 2);
+    if (magic != TAG_MAGIC || count > MAX_TAGS)
+        return 0; // never stored: keep the defaults
+    coordinator.clearTags();
+    uint8_t restored = 0;
+    for (uint8_t i = 0; i < count; ++i)
+    {
+        uint8_t slot[1 + MAX_TAG_ID_LEN];
+        writer.readBlock(tagAddr(i), slot, sizeof(slot));
+        if (writer.read(tagAddr(i) + sizeof(slot)) != checkByte(slot, sizeof(slot)))
+            continue;
+        if (coordinator.addTag(slot + 1, slot[0]))
+            ++restored;
+    }
+#if DEBUG_MODE
+    DBG_S("[EE] tags restored=");
+    DBG_VL(restored);
+#endif
+    return restored;
+}
+
+bool TableStore::stepInterval(uint8_t slot)
+{
+    const IntervalRecord *rec = coordinator.getInterval(slot);
+    if (!rec)
+        return true; // past the count: left as is, ignored on load
+    if (writer.writeBlock(intervalAddr(slot), rec, sizeof(*rec)) != sizeof(*rec))
+        return false;
+    return writer.write(intervalAddr(slot) + sizeof(*rec), checkByte(rec, sizeof(*rec)));
+}
+
+bool TableStore::stepTag(uint8_t slot)
+{
+    uint8_t len;
+    const uint8_t *id = coordinator.getTag(slot, len);
+    if (!id)
+        return true;
+    uint8_t image[1 + MAX_TAG_ID_LEN];
+    memset(image, 0, sizeof(image));
+    image[0] = len;
+    memcpy(image + 1, id, len);
+    if (writer.writeBlock(tagAddr(slot), image, sizeof(image)) != sizeof(image))
+        return false;
+    return writer.write(tagAddr(slot) + sizeof(image), checkByte(image, sizeof(image)));
+}
+
+bool TableStore::stepHeader(uint16_t addr, uint16_t magic, uint8_t count)
+{
+    if (writer.writeBlock(addr, &magic, sizeof(magic)) != sizeof(magic))
+        return false;
+    return writer.write(addr + 2, count);
+}
+
+// Queues the sweep step at cursor; false if the queue filled up first.
+bool TableStore::step()
+{
+    if (cursor < STEP_INTERVAL_HEADER)
+        return stepInterval(cursor);
+    if (cursor == STEP_INTERVAL_HEADER)
+        return stepHeader(INTERVALS_ADDR, INTERVAL_MAGIC, coordinator.getIntervalCount());
+    if (cursor < STEP_TAG_HEADER)
+        return stepTag(cursor - STEP_FIRST_TAG);
+    return stepHeader(TAGS_ADDR, TAG_MAGIC, coordinator.getNumTags());
+}
+
+void TableStore::loop()
+{
+    // Comparing reads the EEPROM, which stalls while a byte is programmed.
+    if (writer.busy())
+        return;
+    if (!step())
+        return; // queue full; the rest of this step is retried next time
+    if (++cursor > STEP_TAG_HEADER)
+        cursor = 0;
+}
+
+void TableStore::sync()
+{
+    for (cursor = 0; cursor <= STEP_TAG_HEADER; ++cursor)
+    {
+        // Bytes already queued are merged or skipped on the retry.
+        while (!step())
+            writer.flush();
+    }
+    cursor = 0;
+    writer.flush();
+}
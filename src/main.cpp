@@ -1,19 +1,94 @@
 #include <Arduino.h>
 #include "Core/SystemCoordinator.h"
+#include "Core/Watchdog.h"
 #include "Bluetooth/BluetoothManager.h"
 #include "RFID/RFIDManager.h"
+#include "Diag/MemProfiler.h"
+#include "Storage/EepromWriter.h"
+#include "Storage/TableStore.h"
+#ifdef BUS_SERIAL
+#include "Bus/DoorBus.h"
+#endif
 
-SystemCoordinator coordinator;
+// Not cleared by the C runtime: after a watchdog or external reset the
+// coordinator validates what is left here and resumes instead of re-initing.
+SystemCoordinator coordinator __attribute__((section(".noinit")));
+Watchdog watchdog;
 BluetoothManager bt(coordinator);
+#ifdef READER2_SERIAL
+// Two-antenna door: the reader on Serial faces out, READER2_SERIAL faces in.
+RFIDManager rfid(coordinator, Serial, READER_OUTSIDE);
+RFIDManager rfidInside(coordinator, READER2_SERIAL, READER_INSIDE);
+#else
 RFIDManager rfid(coordinator);
+#endif
+EepromWriter eeprom;
+TableStore tableStore(coordinator, eeprom);
+#ifdef BUS_SERIAL
+// Multi-door site: -DBUS_SERIAL=Serial1 -DBUS_ADDRESS=<0 primary> -DBUS_NODES=<n>
+DoorBus doorBus(coordinator, BUS_SERIAL, BUS_ADDRESS, BUS_NODES, BUS_DE_PIN);
+#endif
+
+// Static RAM per module, reported by the BT "mem" command next to the live
+// stack high-water mark. Library buffers not inside an object are listed too.
+static const MemFootprint memFootprints[] PROGMEM = {
+    {"coord", sizeof(SystemCoordinator)},
+    {"bt", sizeof(BluetoothManager)},
+    {"bt_rx", _SS_MAX_RX_BUFF},
+    {"rfid", sizeof(RFIDManager)},
+#ifdef READER2_SERIAL
+    {"rfid2", sizeof(RFIDManager)},
+#endif
+    {"serial", sizeof(HardwareSerial)},
+    {"wdt", sizeof(Watchdog)},
+#ifdef BUS_SERIAL
+    {"bus", sizeof(DoorBus)},
+#endif
+};
+
+// BT "reboot": the EEPROM catches up with the tables first, so nothing is
+// lost even if the warm resume fails its checksum.
+static void shutdown()
+{
+    tableStore.sync();
+    Watchdog::reboot();
+}
 
 void setup()
 {
-    Serial.begin(115200);
-    coordinator.begin();
+    MemProfiler::begin(memFootprints, sizeof(memFootprints) / sizeof(memFootprints[0]));
+    Serial.begin(RFIDManager::BAUD);
+    // A power-on or brown-out leaves SRAM undefined; never trust it.
+    coordinator.begin(!watchdog.wasPowerOnReset());
+    // A warm start kept the tables in RAM; EEPROM may lag them by a few
+    // writes. Defaults first: a stored tag table replaces them.
+    if (!coordinator.wasWarmStart())
+    {
+        RFIDManager::enrollDefaults(coordinator);
+        tableStore.load();
+    }
+#ifdef BUS_SERIAL
+    watchdog.begin(WDT_TASK_BT | WDT_TASK_RFID | WDT_TASK_COORD | WDT_TASK_BUS);
+#else
+    watchdog.begin(WDT_TASK_BT | WDT_TASK_RFID | WDT_TASK_COORD);
+#endif
     bt.begin();
+    bt.setShutdownHook(shutdown);
     rfid.begin();
+#ifdef READER2_SERIAL
+    READER2_SERIAL.begin(RFIDManager::BAUD);
+    rfidInside.begin();
+#endif
+#ifdef BUS_SERIAL
+    BUS_SERIAL.begin(BUS_BAUD);
+    doorBus.begin();
+#endif
 #if DEBUG_MODE
+    if (coordinator.wasWarmStart())
+        DBG_S("[SYS] door ready warm us=");
+    else
+        DBG_S("[SYS] door ready cold us=");
+    DBG_VL(coordinator.getReadyUs());
     DBG_SL("PawPass init");
 #endif
 }
@@ -21,7 +96,18 @@ void setup()
 void loop()
 {
     bt.loop();
+    watchdog.kick(WDT_TASK_BT);
     rfid.loop();
+#ifdef READER2_SERIAL
+    rfidInside.loop();
+#endif
+    watchdog.kick(WDT_TASK_RFID);
+#ifdef BUS_SERIAL
+    doorBus.loop();
+    watchdog.kick(WDT_TASK_BUS);
+#endif
     coordinator.loop();
+    tableStore.loop();
+    watchdog.kick(WDT_TASK_COORD);
     delay(10);
 }
\ No newline at end of file